@@ -0,0 +1,812 @@
+#ifndef SJTU_BTREE_MAP_HPP
+#define SJTU_BTREE_MAP_HPP
+
+#include "map.hpp"
+
+namespace sjtu {
+
+// slots in a B-tree node for entries of the given size: about 256 bytes
+// worth, kept within [4, 64]
+constexpr int btree_node_slots(size_t entrySize) {
+    return 256 / entrySize < 4 ? 4 : (256 / entrySize > 64 ? 64 : (int)(256 / entrySize));
+}
+
+/**
+ * map laid out as a counted B+-tree: the values sit in sorted arrays in
+ * linked leaves, the inner nodes hold separator keys and subtree sizes.
+ * A lookup reads a few nodes packed with keys instead of one node per
+ * level of the AVL tree.  Same interface as the AVL map, getByRank
+ * included; unlike it, insert and erase invalidate iterators, because
+ * values move between leaves.
+ */
+template<class Key, class T, class Compare, class Allocator>
+class map<Key, T, Compare, Allocator, btree_policy> {
+public:
+    typedef pair<const Key, T> value_type;
+    typedef Allocator allocator_type;
+private:
+    struct Node {
+        int n;  // values in a leaf, children in an inner node
+    };
+    static const int leafSlots = btree_node_slots(sizeof(value_type));
+    static const int innerSlots = btree_node_slots(sizeof(Key) + sizeof(Node*) + sizeof(size_t));
+    static const int maxHeight = 64;
+    struct Leaf : Node {
+        Leaf *prev, *next;
+        typename std::aligned_storage<sizeof(value_type), alignof(value_type)>::type vals[leafSlots];
+        Leaf(): prev(NULL), next(NULL) {
+            this -> n = 0;
+        }
+        value_type *At(int i) {
+            return reinterpret_cast<value_type*>(vals + i);
+        }
+        const value_type *At(int i) const {
+            return reinterpret_cast<const value_type*>(vals + i);
+        }
+    };
+    struct Inner : Node {
+        Node *child[innerSlots];
+        size_t cnt[innerSlots];  // values below each child
+        // keys under child[i + 1] are >= *Sep(i), keys under child[i] are <
+        typename std::aligned_storage<sizeof(Key), alignof(Key)>::type keys[innerSlots - 1];
+        Inner() {
+            this -> n = 0;
+        }
+        Key *Sep(int i) {
+            return reinterpret_cast<Key*>(keys + i);
+        }
+        const Key *Sep(int i) const {
+            return reinterpret_cast<const Key*>(keys + i);
+        }
+    };
+    typedef std::allocator_traits<Allocator> alloc_traits;
+    typedef typename alloc_traits::template rebind_alloc<Leaf> LeafAlloc;
+    typedef std::allocator_traits<LeafAlloc> leaf_traits;
+    typedef typename alloc_traits::template rebind_alloc<Inner> InnerAlloc;
+    typedef std::allocator_traits<InnerAlloc> inner_traits;
+
+    Compare CmpKey;
+    Allocator alloc;
+    Node *root;  // NULL when empty
+    int height;  // levels of inner nodes above the leaves
+    size_t sizeM;
+    Leaf *firstLeaf, *lastLeaf;
+
+    Leaf *NewLeaf() {
+        LeafAlloc leafAlloc(alloc);
+        Leaf *p = leaf_traits::allocate(leafAlloc, 1);
+        leaf_traits::construct(leafAlloc, p);
+        return p;
+    }
+    void FreeLeaf(Leaf *p) {
+        LeafAlloc leafAlloc(alloc);
+        leaf_traits::destroy(leafAlloc, p);
+        leaf_traits::deallocate(leafAlloc, p, 1);
+    }
+    Inner *NewInner() {
+        InnerAlloc innerAlloc(alloc);
+        Inner *p = inner_traits::allocate(innerAlloc, 1);
+        inner_traits::construct(innerAlloc, p);
+        return p;
+    }
+    void FreeInner(Inner *p) {
+        InnerAlloc innerAlloc(alloc);
+        inner_traits::destroy(innerAlloc, p);
+        inner_traits::deallocate(innerAlloc, p, 1);
+    }
+    // destroy the values and keys of a subtree and free its nodes
+    void DestroyNode(Node *t, int lv) {
+        if (lv == 0) {
+            Leaf *p = static_cast<Leaf*>(t);
+            for (int i = 0; i < p -> n; ++i)
+                alloc_traits::destroy(alloc, p -> At(i));
+            FreeLeaf(p);
+            return;
+        }
+        Inner *p = static_cast<Inner*>(t);
+        for (int i = 0; i < p -> n; ++i)
+            DestroyNode(p -> child[i], lv - 1);
+        for (int i = 0; i + 1 < p -> n; ++i)
+            alloc_traits::destroy(alloc, p -> Sep(i));
+        FreeInner(p);
+    }
+    // copy a subtree, appending its leaves to the list that ends at tail
+    Node *CloneNode(const Node *t, int lv, Leaf *&tail) {
+        if (lv == 0) {
+            const Leaf *other = static_cast<const Leaf*>(t);
+            Leaf *p = NewLeaf();
+            try {
+                for (; p -> n < other -> n; ++(p -> n))
+                    alloc_traits::construct(alloc, p -> At(p -> n), *(other -> At(p -> n)));
+            }
+            catch (...) {
+                DestroyNode(p, 0);
+                throw;
+            }
+            p -> prev = tail;
+            if (tail) tail -> next = p;
+            tail = p;
+            return p;
+        }
+        const Inner *other = static_cast<const Inner*>(t);
+        Inner *p = NewInner();
+        int keys = 0, kids = 0;
+        try {
+            for (; keys + 1 < other -> n; ++keys)
+                alloc_traits::construct(alloc, p -> Sep(keys), *(other -> Sep(keys)));
+            for (; kids < other -> n; ++kids) {
+                p -> child[kids] = CloneNode(other -> child[kids], lv - 1, tail);
+                p -> cnt[kids] = other -> cnt[kids];
+            }
+        }
+        catch (...) {
+            for (int i = 0; i < kids; ++i)
+                DestroyNode(p -> child[i], lv - 1);
+            for (int i = 0; i < keys; ++i)
+                alloc_traits::destroy(alloc, p -> Sep(i));
+            FreeInner(p);
+            throw;
+        }
+        p -> n = other -> n;
+        return p;
+    }
+
+    bool Full(const Node *t, int lv) const {
+        return t -> n == (lv == 0 ? leafSlots : innerSlots);
+    }
+    int MinFill(int lv) const {
+        return (lv == 0 ? leafSlots : innerSlots) / 2;
+    }
+    static size_t Count(const Inner *x) {
+        size_t ret = 0;
+        for (int i = 0; i < x -> n; ++i)
+            ret += x -> cnt[i];
+        return ret;
+    }
+    // first value in p whose key is not less than key
+    template<class K>
+    int LowerBound(const Leaf *p, const K &key) const {
+        int lo = 0, hi = p -> n;
+        while (lo < hi) {
+            int mid = (lo + hi) >> 1;
+            if (CmpKey(p -> At(mid) -> first, key)) lo = mid + 1;
+            else hi = mid;
+        }
+        return lo;
+    }
+    // child of x whose range holds key
+    template<class K>
+    int ChildIndex(const Inner *x, const K &key) const {
+        int lo = 0, hi = x -> n - 1;
+        while (lo < hi) {
+            int mid = (lo + hi) >> 1;
+            if (CmpKey(key, *(x -> Sep(mid)))) hi = mid;
+            else lo = mid + 1;
+        }
+        return lo;
+    }
+    template<class K>
+    Leaf *Find(const K &key, int &idx) const {
+        if (root == NULL) return NULL;
+        Node *t = root;
+        for (int lv = height; lv > 0; --lv) {
+            const Inner *x = static_cast<const Inner*>(t);
+            t = x -> child[ChildIndex(x, key)];
+        }
+        Leaf *p = static_cast<Leaf*>(t);
+        idx = LowerBound(p, key);
+        if (idx == p -> n || CmpKey(key, p -> At(idx) -> first)) return NULL;
+        return p;
+    }
+    // the k-th (1-based) value
+    Leaf *GetKth(size_t k, int &idx) const {
+        Node *t = root;
+        for (int lv = height; lv > 0; --lv) {
+            const Inner *x = static_cast<const Inner*>(t);
+            int i = 0;
+            while (k > x -> cnt[i]) k -= x -> cnt[i++];
+            t = x -> child[i];
+        }
+        idx = k - 1;
+        return static_cast<Leaf*>(t);
+    }
+
+    // open a slot for a new child at i, whose separator Sep(i - 1) is left raw
+    void OpenChild(Inner *x, int i) {
+        shift(alloc, x -> Sep(i), x -> Sep(i - 1), x -> n - i);
+        for (int j = x -> n; j > i; --j) {
+            x -> child[j] = x -> child[j - 1];
+            x -> cnt[j] = x -> cnt[j - 1];
+        }
+        ++(x -> n);
+    }
+    // drop child i, whose separator Sep(i - 1) is already raw
+    void CloseChild(Inner *x, int i) {
+        shift(alloc, x -> Sep(i - 1), x -> Sep(i), x -> n - 1 - i);
+        for (int j = i; j + 1 < x -> n; ++j) {
+            x -> child[j] = x -> child[j + 1];
+            x -> cnt[j] = x -> cnt[j + 1];
+        }
+        --(x -> n);
+    }
+    void SetSep(Inner *x, int i, const Key &key) {
+        Key tmp(key);
+        alloc_traits::destroy(alloc, x -> Sep(i));
+        alloc_traits::construct(alloc, x -> Sep(i), std::move(tmp));
+    }
+    // split the full child i of x (at level lv) in two halves
+    void SplitChild(Inner *x, int i, int lv) {
+        if (lv == 0) {
+            Leaf *c = static_cast<Leaf*>(x -> child[i]), *r = NewLeaf();
+            int keep = c -> n / 2;
+            try {
+                relocate(alloc, r -> At(0), c -> At(keep), c -> n - keep);
+            }
+            catch (...) {
+                FreeLeaf(r);
+                throw;
+            }
+            r -> n = c -> n - keep;
+            c -> n = keep;
+            OpenChild(x, i + 1);
+            try {
+                alloc_traits::construct(alloc, x -> Sep(i), r -> At(0) -> first);
+            }
+            catch (...) {
+                CloseChild(x, i + 1);
+                relocate(alloc, c -> At(keep), r -> At(0), r -> n);
+                c -> n += r -> n;
+                FreeLeaf(r);
+                throw;
+            }
+            r -> prev = c;
+            r -> next = c -> next;
+            if (c -> next) c -> next -> prev = r;
+            else lastLeaf = r;
+            c -> next = r;
+            x -> child[i + 1] = r;
+            x -> cnt[i + 1] = r -> n;
+            x -> cnt[i] -= r -> n;
+            return;
+        }
+        Inner *c = static_cast<Inner*>(x -> child[i]), *r = NewInner();
+        // children [keep, n) and the keys between them go right, Sep(keep - 1) goes up
+        int keep = c -> n / 2;
+        try {
+            relocate(alloc, r -> Sep(0), c -> Sep(keep), c -> n - 1 - keep);
+        }
+        catch (...) {
+            FreeInner(r);
+            throw;
+        }
+        OpenChild(x, i + 1);
+        relocate(alloc, x -> Sep(i), c -> Sep(keep - 1), 1);
+        for (int j = keep; j < c -> n; ++j) {
+            r -> child[j - keep] = c -> child[j];
+            r -> cnt[j - keep] = c -> cnt[j];
+        }
+        r -> n = c -> n - keep;
+        c -> n = keep;
+        x -> child[i + 1] = r;
+        x -> cnt[i + 1] = Count(r);
+        x -> cnt[i] -= x -> cnt[i + 1];
+    }
+    // merge child j + 1 of x into child j
+    void Merge(Inner *x, int j, int lv) {
+        if (lv == 0) {
+            Leaf *l = static_cast<Leaf*>(x -> child[j]), *r = static_cast<Leaf*>(x -> child[j + 1]);
+            relocate(alloc, l -> At(l -> n), r -> At(0), r -> n);
+            l -> n += r -> n;
+            l -> next = r -> next;
+            if (r -> next) r -> next -> prev = l;
+            else lastLeaf = l;
+            FreeLeaf(r);
+            alloc_traits::destroy(alloc, x -> Sep(j));
+        }
+        else {
+            Inner *l = static_cast<Inner*>(x -> child[j]), *r = static_cast<Inner*>(x -> child[j + 1]);
+            relocate(alloc, l -> Sep(l -> n - 1), x -> Sep(j), 1);
+            relocate(alloc, l -> Sep(l -> n), r -> Sep(0), r -> n - 1);
+            for (int k = 0; k < r -> n; ++k) {
+                l -> child[l -> n + k] = r -> child[k];
+                l -> cnt[l -> n + k] = r -> cnt[k];
+            }
+            l -> n += r -> n;
+            FreeInner(r);
+        }
+        x -> cnt[j] += x -> cnt[j + 1];
+        CloseChild(x, j + 1);
+    }
+    // move one value (or child) from child i - 1 of x to the front of child i
+    void BorrowLeft(Inner *x, int i, int lv) {
+        if (lv == 0) {
+            Leaf *l = static_cast<Leaf*>(x -> child[i - 1]), *c = static_cast<Leaf*>(x -> child[i]);
+            shift(alloc, c -> At(1), c -> At(0), c -> n);
+            relocate(alloc, c -> At(0), l -> At(l -> n - 1), 1);
+            --(l -> n);
+            ++(c -> n);
+            SetSep(x, i - 1, c -> At(0) -> first);
+            --(x -> cnt[i - 1]);
+            ++(x -> cnt[i]);
+            return;
+        }
+        Inner *l = static_cast<Inner*>(x -> child[i - 1]), *c = static_cast<Inner*>(x -> child[i]);
+        shift(alloc, c -> Sep(1), c -> Sep(0), c -> n - 1);
+        relocate(alloc, c -> Sep(0), x -> Sep(i - 1), 1);
+        relocate(alloc, x -> Sep(i - 1), l -> Sep(l -> n - 2), 1);
+        for (int k = c -> n; k > 0; --k) {
+            c -> child[k] = c -> child[k - 1];
+            c -> cnt[k] = c -> cnt[k - 1];
+        }
+        c -> child[0] = l -> child[l -> n - 1];
+        c -> cnt[0] = l -> cnt[l -> n - 1];
+        --(l -> n);
+        ++(c -> n);
+        x -> cnt[i - 1] -= c -> cnt[0];
+        x -> cnt[i] += c -> cnt[0];
+    }
+    // move one value (or child) from child i + 1 of x to the back of child i
+    void BorrowRight(Inner *x, int i, int lv) {
+        if (lv == 0) {
+            Leaf *c = static_cast<Leaf*>(x -> child[i]), *r = static_cast<Leaf*>(x -> child[i + 1]);
+            relocate(alloc, c -> At(c -> n), r -> At(0), 1);
+            shift(alloc, r -> At(0), r -> At(1), r -> n - 1);
+            ++(c -> n);
+            --(r -> n);
+            SetSep(x, i, r -> At(0) -> first);
+            ++(x -> cnt[i]);
+            --(x -> cnt[i + 1]);
+            return;
+        }
+        Inner *c = static_cast<Inner*>(x -> child[i]), *r = static_cast<Inner*>(x -> child[i + 1]);
+        size_t moved = r -> cnt[0];
+        relocate(alloc, c -> Sep(c -> n - 1), x -> Sep(i), 1);
+        relocate(alloc, x -> Sep(i), r -> Sep(0), 1);
+        shift(alloc, r -> Sep(0), r -> Sep(1), r -> n - 2);
+        c -> child[c -> n] = r -> child[0];
+        c -> cnt[c -> n] = moved;
+        for (int k = 0; k + 1 < r -> n; ++k) {
+            r -> child[k] = r -> child[k + 1];
+            r -> cnt[k] = r -> cnt[k + 1];
+        }
+        ++(c -> n);
+        --(r -> n);
+        x -> cnt[i] += moved;
+        x -> cnt[i + 1] -= moved;
+    }
+    // give child i of x (at level lv) a value to spare before descending
+    // into it; returns the index of the child that now covers its range
+    int Refill(Inner *x, int i, int lv) {
+        if (x -> n == 1) return i;
+        if (i > 0 && x -> child[i - 1] -> n > MinFill(lv)) BorrowLeft(x, i, lv);
+        else if (i + 1 < x -> n && x -> child[i + 1] -> n > MinFill(lv)) BorrowRight(x, i, lv);
+        else if (i > 0) Merge(x, --i, lv);
+        else Merge(x, i, lv);
+        return i;
+    }
+
+    // deep copy other's tree into this (empty) map
+    void CopyFrom(const map &other) {
+        if (other.root == NULL) return;
+        Leaf *tail = NULL;
+        root = CloneNode(other.root, other.height, tail);
+        height = other.height;
+        sizeM = other.sizeM;
+        lastLeaf = tail;
+        Node *t = root;
+        for (int lv = height; lv > 0; --lv)
+            t = static_cast<Inner*>(t) -> child[0];
+        firstLeaf = static_cast<Leaf*>(t);
+    }
+    // take other's tree, leaving it empty; allocators must be compatible
+    void StealFrom(map &other) {
+        root = other.root;
+        height = other.height;
+        sizeM = other.sizeM;
+        firstLeaf = other.firstLeaf;
+        lastLeaf = other.lastLeaf;
+        other.root = NULL;
+        other.height = 0;
+        other.sizeM = 0;
+        other.firstLeaf = other.lastLeaf = NULL;
+    }
+
+public:
+	class const_iterator;
+	class iterator {
+	    friend class map;
+	private:
+	    map *ctn;
+        Leaf *leaf;  // NULL for end()
+        int idx;
+        iterator(map *ctnA, Leaf *leafA, int idxA): ctn(ctnA), leaf(leafA), idx(idxA) {}
+    public:
+		iterator(): ctn(NULL), leaf(NULL), idx(0) {}
+		iterator(const iterator &other): ctn(other.ctn), leaf(other.leaf), idx(other.idx) {}
+		iterator &operator=(const iterator &other) = default;
+		iterator operator++(int) {
+            iterator tmp(*this);
+            ++*this;
+            return tmp;
+		}
+		iterator & operator++() {
+            if (leaf == NULL) throw invalid_iterator();
+            if (++idx == leaf -> n) {
+                leaf = leaf -> next;
+                idx = 0;
+            }
+            return *this;
+		}
+		iterator operator--(int) {
+            iterator tmp(*this);
+            --*this;
+            return tmp;
+		}
+		iterator & operator--() {
+            if (leaf == NULL) {
+                if (ctn == NULL || ctn -> lastLeaf == NULL) throw invalid_iterator();
+                leaf = ctn -> lastLeaf;
+                idx = leaf -> n - 1;
+            }
+            else if (idx > 0) --idx;
+            else if (leaf -> prev) {
+                leaf = leaf -> prev;
+                idx = leaf -> n - 1;
+            }
+            else throw invalid_iterator();
+            return *this;
+		}
+		value_type & operator*() const {
+            if (leaf == NULL) throw invalid_iterator();
+            return *(leaf -> At(idx));
+		}
+		bool operator==(const iterator &rhs) const {
+            return (ctn == rhs.ctn) && (leaf == rhs.leaf) && (idx == rhs.idx);
+		}
+		bool operator==(const const_iterator &rhs) const {
+            return (ctn == rhs.ctn) && (leaf == rhs.leaf) && (idx == rhs.idx);
+		}
+		bool operator!=(const iterator &rhs) const {
+            return !(*this == rhs);
+		}
+		bool operator!=(const const_iterator &rhs) const {
+		    return !(*this == rhs);
+		}
+		value_type* operator->() const noexcept {
+            return leaf -> At(idx);
+		}
+	};
+	class const_iterator {
+        friend class map;
+    private:
+        const map *ctn;
+        const Leaf *leaf;
+        int idx;
+        const_iterator(const map *ctnA, const Leaf *leafA, int idxA): ctn(ctnA), leaf(leafA), idx(idxA) {}
+    public:
+        const_iterator(): ctn(NULL), leaf(NULL), idx(0) {}
+        const_iterator(const const_iterator &other): ctn(other.ctn), leaf(other.leaf), idx(other.idx) {}
+        const_iterator(const iterator &other): ctn(other.ctn), leaf(other.leaf), idx(other.idx) {}
+        const_iterator &operator=(const const_iterator &other) = default;
+
+        const_iterator operator++(int) {
+            const_iterator tmp(*this);
+            ++*this;
+            return tmp;
+		}
+		const_iterator & operator++() {
+            if (leaf == NULL) throw invalid_iterator();
+            if (++idx == leaf -> n) {
+                leaf = leaf -> next;
+                idx = 0;
+            }
+            return *this;
+		}
+		const_iterator operator--(int) {
+            const_iterator tmp(*this);
+            --*this;
+            return tmp;
+		}
+		const_iterator & operator--() {
+            if (leaf == NULL) {
+                if (ctn == NULL || ctn -> lastLeaf == NULL) throw invalid_iterator();
+                leaf = ctn -> lastLeaf;
+                idx = leaf -> n - 1;
+            }
+            else if (idx > 0) --idx;
+            else if (leaf -> prev) {
+                leaf = leaf -> prev;
+                idx = leaf -> n - 1;
+            }
+            else throw invalid_iterator();
+            return *this;
+		}
+		const value_type & operator*() const {
+            if (leaf == NULL) throw invalid_iterator();
+            return *(leaf -> At(idx));
+		}
+		bool operator==(const iterator &rhs) const {
+            return (ctn == rhs.ctn) && (leaf == rhs.leaf) && (idx == rhs.idx);
+		}
+		bool operator==(const const_iterator &rhs) const {
+            return (ctn == rhs.ctn) && (leaf == rhs.leaf) && (idx == rhs.idx);
+		}
+		bool operator!=(const iterator &rhs) const {
+            return !(*this == rhs);
+		}
+		bool operator!=(const const_iterator &rhs) const {
+		    return !(*this == rhs);
+		}
+		const value_type* operator->() const noexcept {
+            return leaf -> At(idx);
+		}
+	};
+
+	map(): root(NULL), height(0), sizeM(0), firstLeaf(NULL), lastLeaf(NULL) {}
+	explicit map(const Allocator &a):
+	    alloc(a), root(NULL), height(0), sizeM(0), firstLeaf(NULL), lastLeaf(NULL) {}
+	map(const map &other):
+	    CmpKey(other.CmpKey),
+	    alloc(alloc_traits::select_on_container_copy_construction(other.alloc)),
+	    root(NULL), height(0), sizeM(0), firstLeaf(NULL), lastLeaf(NULL) {
+        CopyFrom(other);
+	}
+	map(map &&other):
+	    CmpKey(other.CmpKey), alloc(std::move(other.alloc)),
+	    root(NULL), height(0), sizeM(0), firstLeaf(NULL), lastLeaf(NULL) {
+        StealFrom(other);
+	}
+	map & operator=(const map &other) {
+        if (&other == this) return *this;
+        clear();
+        if (alloc_traits::propagate_on_container_copy_assignment::value)
+            alloc = other.alloc;
+        CmpKey = other.CmpKey;
+        CopyFrom(other);
+        return *this;
+	}
+	map & operator=(map &&other) {
+        if (&other == this) return *this;
+        clear();
+        CmpKey = other.CmpKey;
+        if (alloc_traits::propagate_on_container_move_assignment::value) {
+            alloc = std::move(other.alloc);
+            StealFrom(other);
+        }
+        else if (alloc == other.alloc) StealFrom(other);
+        else {
+            // nodes from a foreign allocator must be rebuilt with ours
+            CopyFrom(other);
+            other.clear();
+        }
+        return *this;
+	}
+	~map() {
+        clear();
+    }
+	void swap(map &other) {
+        if (alloc_traits::propagate_on_container_swap::value)
+            std::swap(alloc, other.alloc);
+        std::swap(CmpKey, other.CmpKey);
+        std::swap(root, other.root);
+        std::swap(height, other.height);
+        std::swap(sizeM, other.sizeM);
+        std::swap(firstLeaf, other.firstLeaf);
+        std::swap(lastLeaf, other.lastLeaf);
+	}
+	allocator_type get_allocator() const {
+        return alloc;
+	}
+
+	T & at(const Key &key) {
+        int idx;
+        Leaf *p = Find(key, idx);
+        if (!p) throw index_out_of_bound();
+        return p -> At(idx) -> second;
+	}
+	const T & at(const Key &key) const {
+        int idx;
+        const Leaf *p = Find(key, idx);
+        if (!p) throw index_out_of_bound();
+        return p -> At(idx) -> second;
+	}
+	T & operator[](const Key &key) {
+        int idx;
+        Leaf *p = Find(key, idx);
+        if (p) return p -> At(idx) -> second;
+        iterator newIt = insert(value_type(key, T())).first;
+        return newIt -> second;
+	}
+	const T & operator[](const Key &key) const {
+        return at(key);
+	}
+	// lookups by anything Compare can order against Key; only a missing
+	// key given to operator[] is converted to a Key
+	template<class K, class C = Compare, class = typename C::is_transparent>
+	T & at(const K &key) {
+        int idx;
+        Leaf *p = Find(key, idx);
+        if (!p) throw index_out_of_bound();
+        return p -> At(idx) -> second;
+	}
+	template<class K, class C = Compare, class = typename C::is_transparent>
+	const T & at(const K &key) const {
+        int idx;
+        const Leaf *p = Find(key, idx);
+        if (!p) throw index_out_of_bound();
+        return p -> At(idx) -> second;
+	}
+	template<class K, class C = Compare, class = typename C::is_transparent>
+	T & operator[](const K &key) {
+        int idx;
+        Leaf *p = Find(key, idx);
+        if (p) return p -> At(idx) -> second;
+        iterator newIt = insert(value_type(Key(key), T())).first;
+        return newIt -> second;
+	}
+	template<class K, class C = Compare, class = typename C::is_transparent>
+	const T & operator[](const K &key) const {
+        return at(key);
+	}
+
+	iterator begin() {
+        return iterator(this, firstLeaf, 0);
+    }
+	const_iterator cbegin() const {
+        return const_iterator(this, firstLeaf, 0);
+	}
+	iterator end() {
+        return iterator(this, NULL, 0);
+	}
+	const_iterator cend() const {
+        return const_iterator(this, NULL, 0);
+	}
+	bool empty() const {
+        return sizeM == 0;
+	}
+	size_t size() const {
+        return sizeM;
+	}
+	void clear() {
+        if (root) DestroyNode(root, height);
+        root = NULL;
+        height = 0;
+        sizeM = 0;
+        firstLeaf = lastLeaf = NULL;
+	}
+	pair<iterator, bool> insert(const value_type &value) {
+        if (root == NULL) {
+            root = firstLeaf = lastLeaf = NewLeaf();
+            height = 0;
+        }
+        // full nodes are split on the way down, so the leaf has room
+        if (Full(root, height)) {
+            Inner *x = NewInner();
+            x -> n = 1;
+            x -> child[0] = root;
+            x -> cnt[0] = sizeM;
+            root = x;
+            ++height;
+            SplitChild(x, 0, height - 1);
+        }
+        Inner *path[maxHeight];
+        int pathIdx[maxHeight];
+        Node *t = root;
+        for (int lv = height; lv > 0; --lv) {
+            Inner *x = static_cast<Inner*>(t);
+            int i = ChildIndex(x, value.first);
+            if (Full(x -> child[i], lv - 1)) {
+                SplitChild(x, i, lv - 1);
+                if (!CmpKey(value.first, *(x -> Sep(i)))) ++i;
+            }
+            path[lv - 1] = x;
+            pathIdx[lv - 1] = i;
+            t = x -> child[i];
+        }
+        Leaf *p = static_cast<Leaf*>(t);
+        int idx = LowerBound(p, value.first);
+        if (idx < p -> n && !CmpKey(value.first, p -> At(idx) -> first))
+            return pair<iterator, bool>(iterator(this, p, idx), false);
+        shift(alloc, p -> At(idx + 1), p -> At(idx), p -> n - idx);
+        try {
+            alloc_traits::construct(alloc, p -> At(idx), value);
+        }
+        catch (...) {
+            shift(alloc, p -> At(idx), p -> At(idx + 1), p -> n - idx);
+            if (sizeM == 0) clear();
+            throw;
+        }
+        ++(p -> n);
+        for (int lv = 0; lv < height; ++lv)
+            ++(path[lv] -> cnt[pathIdx[lv]]);
+        ++sizeM;
+        return pair<iterator, bool>(iterator(this, p, idx), true);
+	}
+	void erase(iterator pos) {
+        if (pos.ctn != this || pos.leaf == NULL) throw index_out_of_bound();
+        // nodes on the way down are refilled first, so the leaf keeps enough values
+        Key key(pos.leaf -> At(pos.idx) -> first);
+        Inner *path[maxHeight];
+        int pathIdx[maxHeight];
+        Node *t = root;
+        for (int lv = height; lv > 0; --lv) {
+            Inner *x = static_cast<Inner*>(t);
+            int i = ChildIndex(x, key);
+            if (x -> child[i] -> n <= MinFill(lv - 1)) i = Refill(x, i, lv - 1);
+            path[lv - 1] = x;
+            pathIdx[lv - 1] = i;
+            t = x -> child[i];
+        }
+        Leaf *p = static_cast<Leaf*>(t);
+        int idx = LowerBound(p, key);
+        alloc_traits::destroy(alloc, p -> At(idx));
+        shift(alloc, p -> At(idx), p -> At(idx + 1), p -> n - idx - 1);
+        --(p -> n);
+        for (int lv = 0; lv < height; ++lv)
+            --(path[lv] -> cnt[pathIdx[lv]]);
+        --sizeM;
+        while (height > 0 && root -> n == 1) {
+            Inner *x = static_cast<Inner*>(root);
+            root = x -> child[0];
+            FreeInner(x);
+            --height;
+        }
+        if (sizeM == 0) clear();
+	}
+
+	size_t count(const Key &key) const {
+        int idx;
+        return Find(key, idx) ? 1 : 0;
+	}
+	iterator find(const Key &key) {
+        int idx;
+        Leaf *p = Find(key, idx);
+        if (!p) return end();
+        return iterator(this, p, idx);
+	}
+	const_iterator find(const Key &key) const {
+        int idx;
+        const Leaf *p = Find(key, idx);
+        if (!p) return cend();
+        return const_iterator(this, p, idx);
+	}
+	template<class K, class C = Compare, class = typename C::is_transparent>
+	size_t count(const K &key) const {
+        int idx;
+        return Find(key, idx) ? 1 : 0;
+	}
+	template<class K, class C = Compare, class = typename C::is_transparent>
+	iterator find(const K &key) {
+        int idx;
+        Leaf *p = Find(key, idx);
+        if (!p) return end();
+        return iterator(this, p, idx);
+	}
+	template<class K, class C = Compare, class = typename C::is_transparent>
+	const_iterator find(const K &key) const {
+        int idx;
+        const Leaf *p = Find(key, idx);
+        if (!p) return cend();
+        return const_iterator(this, p, idx);
+	}
+
+    iterator getByRank(int k) {
+        if (k <= 0 || size_t(k) > sizeM) throw index_out_of_bound();
+        int idx;
+        Leaf *p = GetKth(k, idx);
+        return iterator(this, p, idx);
+    }
+    const_iterator getByRank(int k) const {
+        if (k <= 0 || size_t(k) > sizeM) throw index_out_of_bound();
+        int idx;
+        const Leaf *p = GetKth(k, idx);
+        return const_iterator(this, p, idx);
+    }
+};
+
+template<class Key, class T, class Compare = std::less<Key>, class Allocator = std::allocator<pair<const Key, T>>>
+using btree_map = map<Key, T, Compare, Allocator, btree_policy>;
+
+}
+
+#endif
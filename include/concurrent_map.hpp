@@ -0,0 +1,445 @@
+#ifndef SJTU_CONCURRENT_MAP_HPP
+#define SJTU_CONCURRENT_MAP_HPP
+
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include "utility.hpp"
+#include "exceptions.hpp"
+#include "path_copy_avl.hpp"
+
+namespace sjtu {
+
+template<class V>
+struct ConcurrentNode {
+    int h;
+    unsigned long stamp;  // the write that made it, and alone may change it
+    ConcurrentNode *l, *r;
+    ConcurrentNode *link;  // in the fresh, replaced or retired list; readers never look
+    V val;
+    template<class... Args>
+    ConcurrentNode(Args&&... args): h(0), stamp(0), l(NULL), r(NULL), link(NULL), val(std::forward<Args>(args)...) {}
+};
+
+/**
+ * AVL map for many reader threads and few writes.  Published nodes are
+ * never changed: a write copies the path it touches, as persistent_map
+ * does, and swings the root to the new version, so find, at, count and
+ * for_each run without taking any lock.  Writers take one mutex between
+ * them.
+ *
+ * A replaced node is freed only once every reader that might still see it
+ * has left.  Readers announce themselves, under the epoch they started
+ * in, in a counter picked per thread from a cache-line-padded array; every
+ * reclaimBatch replaced nodes a writer advances the epoch and waits for
+ * the old one's counters to drain, still holding the writer mutex: a
+ * reader that stays in for_each holds up that write and every write
+ * queued behind it.  For the same reason a for_each callback must not
+ * write to the map it walks (checked by assert).
+ *
+ * Lookups hand back copies, since a reference could outlive the node.
+ * No thread may use the map while it is being destroyed.
+ */
+template<
+	class Key,
+	class T,
+	class Compare = std::less<Key>,
+	class Allocator = std::allocator<pair<const Key, T>>
+> class concurrent_map : PathCopyAvl<concurrent_map<Key, T, Compare, Allocator>, ConcurrentNode<pair<const Key, T>>, Allocator> {
+public:
+    typedef pair<const Key, T> value_type;
+    typedef Allocator allocator_type;
+private:
+    typedef ConcurrentNode<value_type> Node;
+    typedef PathCopyAvl<concurrent_map, Node, Allocator> Core;
+    friend Core;
+    using Core::maxDepth;
+    using Core::alloc;
+    using Core::DeleteNode;
+    using Core::GetH;
+    using Core::Balance;
+
+    static const int readerShards = 64;
+    static const size_t reclaimBatch = 1024;
+    struct alignas(64) ReaderShard {
+        std::atomic<long> active[2];  // readers in an even or odd epoch
+    };
+
+    Compare CmpKey;
+    std::atomic<Node*> root;
+    std::atomic<size_t> sizeM;
+    mutable ReaderShard shards[readerShards];
+    std::atomic<unsigned long> epoch;
+    // the rest belongs to whoever holds writer
+    std::mutex writer;
+    unsigned long stamp;
+    Node *fresh, *replaced;  // made and unlinked by the write in progress
+    Node *retired;  // unlinked by earlier writes, waiting for readers
+    size_t retiredCnt;
+
+    // the counter this thread announces itself in
+    static unsigned Shard() {
+        static std::atomic<unsigned> threads(0);
+        thread_local unsigned mine = threads.fetch_add(1, std::memory_order_relaxed) % readerShards;
+        return mine;
+    }
+    // holds off reclamation of anything the reader can reach while it lives
+    class ReadGuard {
+        std::atomic<long> *counter;
+#ifndef NDEBUG
+        friend concurrent_map;
+        const concurrent_map *owner;
+        const ReadGuard *outer;
+#endif
+    public:
+        explicit ReadGuard(const concurrent_map &ctn) {
+#ifndef NDEBUG
+            owner = &ctn;
+            outer = Innermost();
+            Innermost() = this;
+#endif
+            ReaderShard &shard = ctn.shards[Shard()];
+            while (true) {
+                unsigned long e = ctn.epoch.load();
+                counter = &shard.active[e & 1];
+                counter -> fetch_add(1);
+                // a writer may have moved on before it could see us
+                if (ctn.epoch.load() == e) return;
+                counter -> fetch_sub(1);
+            }
+        }
+        ~ReadGuard() {
+            counter -> fetch_sub(1, std::memory_order_release);
+#ifndef NDEBUG
+            Innermost() = outer;
+#endif
+        }
+    };
+#ifndef NDEBUG
+    // the guards this thread holds, innermost first
+    static const ReadGuard *&Innermost() {
+        thread_local const ReadGuard *top = NULL;
+        return top;
+    }
+    // a write from inside for_each could wait on its own guard forever
+    bool ReadByThisThread() const {
+        for (const ReadGuard *g = Innermost(); g; g = g -> outer)
+            if (g -> owner == this) return true;
+        return false;
+    }
+#endif
+
+    // a node of the write in progress
+    template<class... Args>
+    Node *NewNode(Args&&... args) {
+        Node *t = Core::NewNode(std::forward<Args>(args)...);
+        t -> stamp = stamp;
+        t -> link = fresh;
+        fresh = t;
+        return t;
+    }
+    void Replace(Node *t) {
+        t -> link = replaced;
+        replaced = t;
+    }
+    // make the node at link one this write may change, copying it if it
+    // is published
+    void Own(Node *&link) {
+        Node *t = link;
+        if (t -> stamp == stamp) return;
+        Node *t1 = NewNode(t -> val);
+        t1 -> h = t -> h;
+        t1 -> l = t -> l;
+        t1 -> r = t -> r;
+        Replace(t);
+        link = t1;
+    }
+    void Begin() {
+        ++stamp;
+        fresh = replaced = NULL;
+    }
+    // publish top; what it replaced is retired
+    void Commit(Node *top) {
+        root.store(top, std::memory_order_release);
+        while (replaced) {
+            Node *t = replaced;
+            replaced = t -> link;
+            t -> link = retired;
+            retired = t;
+            ++retiredCnt;
+        }
+        fresh = NULL;
+        if (retiredCnt >= reclaimBatch) Reclaim();
+    }
+    // the write failed: nothing was published, so only its copies go
+    void Abort() {
+        while (fresh) {
+            Node *t = fresh;
+            fresh = t -> link;
+            DeleteNode(t);
+        }
+        replaced = NULL;
+    }
+    // advance the epoch, wait for the readers of the old one, then free
+    // what was retired before
+    void Reclaim() {
+        unsigned long e = epoch.load();
+        epoch.store(e + 1);
+        for (int i = 0; i < readerShards; ++i) {
+            while (shards[i].active[e & 1].load() != 0) std::this_thread::yield();
+        }
+        while (retired) {
+            Node *t = retired;
+            retired = t -> link;
+            DeleteNode(t);
+        }
+        retiredCnt = 0;
+    }
+    // put every node under t on the retired list
+    void RetireTree(Node *t) {
+        Node *stack = NULL;
+        if (t) {
+            t -> link = NULL;
+            stack = t;
+        }
+        while (stack) {
+            Node *x = stack;
+            stack = x -> link;
+            if (x -> l) {
+                x -> l -> link = stack;
+                stack = x -> l;
+            }
+            if (x -> r) {
+                x -> r -> link = stack;
+                stack = x -> r;
+            }
+            x -> link = retired;
+            retired = x;
+            ++retiredCnt;
+        }
+    }
+
+    static void Update(Node *t) {
+        t -> h = gmax(GetH(t -> l), GetH(t -> r)) + 1;
+    }
+
+    const Node *Find(const Node *t, const Key &key) const {
+        while (t) {
+            if (CmpKey(key, t -> val.first)) t = t -> l;
+            else if (CmpKey(t -> val.first, key)) t = t -> r;
+            else return t;
+        }
+        return NULL;
+    }
+    // copy the path from top to key, stopping above the node holding it;
+    // path[i] is the link to the node at depth i.  Returns the depth of
+    // that node, or of the empty link where key would go
+    int OwnPath(Node *&top, const Key &key, Node **path[]) {
+        int depth = 0;
+        Node **link = &top;
+        while (*link) {
+            Node *t = *link;
+            if (!CmpKey(key, t -> val.first) && !CmpKey(t -> val.first, key)) break;
+            Own(*link);
+            path[depth++] = link;
+            t = *link;
+            link = CmpKey(key, t -> val.first) ? &(t -> l) : &(t -> r);
+        }
+        path[depth] = link;
+        return depth;
+    }
+    // hang a node from make() where OwnPath found key missing
+    template<class Make>
+    void Insert(Node *&top, const Key &key, const Make &make) {
+        Node **path[maxDepth + 1];
+        int depth = OwnPath(top, key, path);
+        *path[depth] = make();
+        while (depth > 0) Balance(*path[--depth]);
+    }
+    // put a node from make() in place of the published x holding key
+    template<class Make>
+    void Reset(Node *&top, const Key &key, const Make &make) {
+        Node **path[maxDepth + 1];
+        int depth = OwnPath(top, key, path);
+        Node *x = *path[depth], *t = make();
+        t -> h = x -> h;
+        t -> l = x -> l;
+        t -> r = x -> r;
+        *path[depth] = t;
+        Replace(x);
+    }
+    void Remove(Node *&top, const Key &key) {
+        Node **path[maxDepth + 1];
+        int depth = OwnPath(top, key, path);
+        Node *x = *path[depth];
+        Replace(x);
+        if (x -> l == NULL || x -> r == NULL) *path[depth] = x -> l ? x -> l : x -> r;
+        else {
+            // take the successor out of x's right subtree, which is
+            // rebuilt on the side, and put a copy of it in x's place
+            Node *sub = x -> r, **link = &sub, **subPath[maxDepth];
+            int subDepth = 0;
+            while ((*link) -> l) {
+                Own(*link);
+                subPath[subDepth++] = link;
+                link = &((*link) -> l);
+            }
+            Node *s = *link;
+            Replace(s);
+            *link = s -> r;
+            while (subDepth > 0) Balance(*subPath[--subDepth]);
+            Node *t = NewNode(s -> val);
+            t -> l = x -> l;
+            t -> r = sub;
+            *path[depth] = t;
+            Balance(*path[depth]);
+        }
+        while (depth > 0) Balance(*path[--depth]);
+    }
+
+public:
+	concurrent_map(): root(NULL), sizeM(0), epoch(0), stamp(0), fresh(NULL), replaced(NULL), retired(NULL), retiredCnt(0) {
+        for (int i = 0; i < readerShards; ++i) shards[i].active[0] = shards[i].active[1] = 0;
+	}
+	explicit concurrent_map(const Allocator &a):
+	    Core(a), root(NULL), sizeM(0), epoch(0), stamp(0), fresh(NULL), replaced(NULL), retired(NULL), retiredCnt(0) {
+        for (int i = 0; i < readerShards; ++i) shards[i].active[0] = shards[i].active[1] = 0;
+	}
+	concurrent_map(const concurrent_map &other) = delete;
+	concurrent_map & operator=(const concurrent_map &other) = delete;
+	~concurrent_map() {
+        RetireTree(root.load());
+        while (retired) {
+            Node *t = retired;
+            retired = t -> link;
+            DeleteNode(t);
+        }
+	}
+	allocator_type get_allocator() const {
+        return alloc;
+	}
+
+	// lock-free; false, with out untouched, if key is absent
+	bool find(const Key &key, T &out) const {
+        ReadGuard guard(*this);
+        const Node *t = Find(root.load(std::memory_order_acquire), key);
+        if (!t) return false;
+        out = t -> val.second;
+        return true;
+	}
+	T at(const Key &key) const {
+        ReadGuard guard(*this);
+        const Node *t = Find(root.load(std::memory_order_acquire), key);
+        if (!t) throw index_out_of_bound();
+        return t -> val.second;
+	}
+	size_t count(const Key &key) const {
+        ReadGuard guard(*this);
+        return Find(root.load(std::memory_order_acquire), key) ? 1 : 0;
+	}
+	// f(const value_type &) on every element of one version, in key order.
+	// f must not write to this map, and writers may wait until it returns
+	template<class F>
+	void for_each(F f) const {
+        ReadGuard guard(*this);
+        const Node *stack[maxDepth];
+        int depth = 0;
+        for (const Node *t = root.load(std::memory_order_acquire); t || depth > 0; ) {
+            if (t) {
+                stack[depth++] = t;
+                t = t -> l;
+            }
+            else {
+                t = stack[--depth];
+                f(t -> val);
+                t = t -> r;
+            }
+        }
+	}
+	bool empty() const {
+        return size() == 0;
+	}
+	size_t size() const {
+        return sizeM.load(std::memory_order_relaxed);
+	}
+
+	// false, changing nothing, if the key is taken
+	bool insert(const value_type &value) {
+        assert(!ReadByThisThread());
+        std::lock_guard<std::mutex> lock(writer);
+        Node *top = root.load(std::memory_order_relaxed);
+        if (Find(top, value.first)) return false;
+        Begin();
+        try {
+            Insert(top, value.first, [&]() {
+                return NewNode(value);
+            });
+        }
+        catch (...) {
+            Abort();
+            throw;
+        }
+        Commit(top);
+        sizeM.fetch_add(1, std::memory_order_relaxed);
+        return true;
+	}
+	// true if the key was new
+	template<class M>
+	bool insert_or_assign(const Key &key, M &&obj) {
+        assert(!ReadByThisThread());
+        std::lock_guard<std::mutex> lock(writer);
+        Node *top = root.load(std::memory_order_relaxed);
+        bool inserted = Find(top, key) == NULL;
+        Begin();
+        try {
+            auto make = [&]() {
+                return NewNode(key, std::forward<M>(obj));
+            };
+            if (inserted) Insert(top, key, make);
+            else Reset(top, key, make);
+        }
+        catch (...) {
+            Abort();
+            throw;
+        }
+        Commit(top);
+        if (inserted) sizeM.fetch_add(1, std::memory_order_relaxed);
+        return inserted;
+	}
+	// true if key was there
+	bool erase(const Key &key) {
+        assert(!ReadByThisThread());
+        std::lock_guard<std::mutex> lock(writer);
+        Node *top = root.load(std::memory_order_relaxed);
+        if (Find(top, key) == NULL) return false;
+        Begin();
+        try {
+            Remove(top, key);
+        }
+        catch (...) {
+            Abort();
+            throw;
+        }
+        Commit(top);
+        sizeM.fetch_sub(1, std::memory_order_relaxed);
+        return true;
+	}
+	void clear() {
+        assert(!ReadByThisThread());
+        std::lock_guard<std::mutex> lock(writer);
+        Node *top = root.load(std::memory_order_relaxed);
+        root.store(NULL, std::memory_order_release);
+        sizeM.store(0, std::memory_order_relaxed);
+        RetireTree(top);
+        Reclaim();
+	}
+};
+
+}
+
+#endif
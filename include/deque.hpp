@@ -2,41 +2,308 @@
 #define SJTU_DEQUE_HPP
 
 #include "exceptions.hpp"
+#include "utility.hpp"
 
 #include <cstddef>
+#include <cstring>
+#include <memory>
+#include <type_traits>
+#include <utility>
 
 namespace sjtu {
 
-template<class T>
+template<class T, class Allocator = std::allocator<T>>
 class deque {
+public:
+    typedef Allocator allocator_type;
 private:
-    static const int maxBlockSize = 1000;
-    struct ListBlock {
+    // elements live inside the block, so big types get fewer of them
+    static const int maxBlockBytes = 16000;
+    static const int maxBlockSize = sizeof(T) * 1000 <= maxBlockBytes ? 1000 :
+        (maxBlockBytes / sizeof(T) < 16 ? 16 : maxBlockBytes / sizeof(T));
+    struct ListBlock;
+    // the links every block has; the end sentinel is only this, so an
+    // empty deque does not carry a block's worth of storage
+    struct BlockHead {
         size_t sizeB;
-        T* data[maxBlockSize];
-        ListBlock *prev, *next;
-        ListBlock(): sizeB(0), prev(NULL), next(NULL) {
-            for (int i = 0; i < maxBlockSize; ++i)
-                data[i] = NULL;
-        }
-        ListBlock(const T &v): sizeB(1), prev(NULL), next(NULL) {
-            data[0] = new T(v);
-            for (int i = 1; i < maxBlockSize; ++i)
-                data[i] = NULL;
-        }
-        ListBlock(const ListBlock &other): sizeB(other.sizeB), prev(NULL), next(NULL) {
-            for (int i = 0; i < sizeB; ++i)
-                data[i] = new T(*(other.data[i]));
-            for (int i = sizeB; i < maxBlockSize; ++i)
-                data[i] = NULL;
-        }
-        ~ListBlock() {
-            for (int i = 0; i < sizeB; ++i)
-                delete data[i];
+        size_t pos;  // index in the block directory
+        ListBlock *prev;
+        BlockHead *next;  // the sentinel after the last block
+        BlockHead(): sizeB(0), pos(0), prev(NULL), next(NULL) {}
+    };
+    struct ListBlock : BlockHead {
+        typename std::aligned_storage<sizeof(T), alignof(T)>::type data[maxBlockSize];
+        // user-provided, so that value-initializing a block through the
+        // allocator does not zero-fill data
+        ListBlock() {}
+        T *At(size_t idx) {
+            return reinterpret_cast<T*>(data + idx);
         }
+        const T *At(size_t idx) const {
+            return reinterpret_cast<const T*>(data + idx);
+        }
+    };
+    typedef std::allocator_traits<Allocator> alloc_traits;
+    typedef typename alloc_traits::template rebind_alloc<ListBlock> BlockAlloc;
+    typedef std::allocator_traits<BlockAlloc> block_traits;
+    // block directory: blocks in list order with the rank of their first
+    // element, stored as start - dirBase so that growing a block only
+    // touches the entries on its shorter side
+    struct DirEntry {
+        long long start;
+        ListBlock *block;
     };
+    typedef typename alloc_traits::template rebind_alloc<DirEntry> DirAlloc;
+    typedef std::allocator_traits<DirAlloc> dir_traits;
+
+    Allocator alloc;
     size_t sizeD;
-    ListBlock *first, *last, pastTheEnd;
+    ListBlock *first, *last;
+    BlockHead pastTheEnd;
+    mutable DirEntry *dir;
+    mutable size_t dirSize, dirCap;
+    mutable long long dirBase;
+    mutable bool dirValid;  // cleared only by wholesale changes: copy, clear, swap
+
+    // a position known not to be the sentinel
+    static ListBlock *AsBlock(BlockHead *p) {
+        return static_cast<ListBlock*>(p);
+    }
+    static const ListBlock *AsBlock(const BlockHead *p) {
+        return static_cast<const ListBlock*>(p);
+    }
+    void RebuildDir() const {
+        size_t cnt = 0;
+        for (const BlockHead *p = first; p && p != &pastTheEnd; p = p->next) ++cnt;
+        if (cnt > dirCap) {
+            DirAlloc dirAlloc(alloc);
+            size_t newCap = dirCap ? dirCap : 16;
+            while (newCap < cnt) newCap <<= 1;
+            DirEntry *newDir = dir_traits::allocate(dirAlloc, newCap);
+            if (dir) dir_traits::deallocate(dirAlloc, dir, dirCap);
+            dir = newDir;
+            dirCap = newCap;
+        }
+        long long start = 0;
+        dirSize = 0;
+        for (BlockHead *p = first; p && p != &pastTheEnd; p = p->next) {
+            p->pos = dirSize;
+            dir[dirSize].start = start;
+            dir[dirSize].block = AsBlock(p);
+            ++dirSize;
+            start += p->sizeB;
+        }
+        dirBase = 0;
+        dirValid = true;
+    }
+    void FreeDir() {
+        if (dir) {
+            DirAlloc dirAlloc(alloc);
+            dir_traits::deallocate(dirAlloc, dir, dirCap);
+        }
+        dir = NULL;
+        dirSize = dirCap = 0;
+        dirValid = false;
+    }
+    // block p gained delta elements without blocks being added or removed
+    void Resized(const ListBlock *p, int delta) {
+        if (!dirValid) return;
+        size_t k = p->pos;
+        if (k < dirSize - 1 - k) {
+            for (size_t i = 0; i <= k; ++i)
+                dir[i].start -= delta;
+            dirBase -= delta;
+        }
+        else {
+            for (size_t i = k + 1; i < dirSize; ++i)
+                dir[i].start += delta;
+        }
+    }
+    // block b was just linked in; the ranks after it grow by added
+    void DirLink(ListBlock *b, int added) {
+        if (!dirValid) return;
+        if (dirSize == dirCap) {
+            DirAlloc dirAlloc(alloc);
+            DirEntry *newDir;
+            try {
+                newDir = dir_traits::allocate(dirAlloc, dirCap ? dirCap << 1 : 16);
+            }
+            catch (...) {
+                dirValid = false;
+                return;
+            }
+            if (dir) {
+                std::memcpy(newDir, dir, dirSize * sizeof(DirEntry));
+                dir_traits::deallocate(dirAlloc, dir, dirCap);
+            }
+            dir = newDir;
+            dirCap = dirCap ? dirCap << 1 : 16;
+        }
+        size_t k = b->prev ? b->prev->pos + 1 : 0;
+        for (size_t i = dirSize; i > k; --i) {
+            dir[i] = dir[i - 1];
+            dir[i].start += added;
+            dir[i].block->pos = i;
+        }
+        dir[k].start = k ? dir[k - 1].start + dir[k - 1].block->sizeB : dirBase;
+        dir[k].block = b;
+        b->pos = k;
+        ++dirSize;
+    }
+    // block b is about to be unlinked; the ranks after it shrink by removed
+    void DirUnlink(const ListBlock *b, int removed) {
+        if (!dirValid) return;
+        for (size_t i = b->pos; i + 1 < dirSize; ++i) {
+            dir[i] = dir[i + 1];
+            dir[i].start -= removed;
+            dir[i].block->pos = i;
+        }
+        --dirSize;
+    }
+    // block holding rank k (k < sizeD); k becomes the index inside it
+    ListBlock *Locate(size_t &k) const {
+        if (!dirValid) RebuildDir();
+        long long target = (long long)k + dirBase;
+        size_t lo = 0, hi = dirSize;
+        while (lo < hi) {
+            size_t mid = (lo + hi) >> 1;
+            if (dir[mid].start <= target) lo = mid + 1;
+            else hi = mid;
+        }
+        k = target - dir[lo - 1].start;
+        return dir[lo - 1].block;
+    }
+    // sizeD is not trusted here: insert and erase adjust it up front
+    int GetRank(const BlockHead *p, int idx) const {
+        if (!dirValid) RebuildDir();
+        if (p == &pastTheEnd) {
+            if (dirSize == 0) return idx;
+            const DirEntry &e = dir[dirSize - 1];
+            return e.start - dirBase + e.block->sizeB + idx;
+        }
+        return dir[p->pos].start - dirBase + idx;
+    }
+    // move (p, idx) by n elements; past the end it sticks to the sentinel
+    template<class Block>
+    void Advance(Block *&p, size_t &idx, int n) const {
+        if (n >= 0 ? (p != &pastTheEnd && idx + n < p->sizeB) : idx >= (size_t)(-n)) {
+            idx += n;
+            return;
+        }
+        int rank = GetRank(p, idx) + n;
+        if (rank < 0) throw invalid_iterator();
+        if ((size_t)rank >= sizeD) {
+            p = const_cast<BlockHead*>(&pastTheEnd);
+            idx = rank - sizeD;
+            return;
+        }
+        idx = rank;
+        p = Locate(idx);
+    }
+
+    // copy n elements into raw slots at dst; nothing is left behind on failure
+    void CopyValues(T *dst, const T *src, int n) {
+        int i = 0;
+        try {
+            for (; i < n; ++i)
+                alloc_traits::construct(alloc, dst + i, src[i]);
+        }
+        catch (...) {
+            DestroyValues(dst, i);
+            throw;
+        }
+    }
+    void DestroyValues(T *p, int n) {
+        for (int i = 0; i < n; ++i)
+            alloc_traits::destroy(alloc, p + i);
+    }
+    ListBlock *NewBlock() {
+        BlockAlloc blockAlloc(alloc);
+        ListBlock *block = block_traits::allocate(blockAlloc, 1);
+        block_traits::construct(blockAlloc, block);
+        return block;
+    }
+    ListBlock *NewBlock(const T &v) {
+        ListBlock *block = NewBlock();
+        try {
+            alloc_traits::construct(alloc, block->At(0), v);
+        }
+        catch (...) {
+            DeleteBlock(block);
+            throw;
+        }
+        block->sizeB = 1;
+        return block;
+    }
+    ListBlock *CloneBlock(const ListBlock &other) {
+        ListBlock *block = NewBlock();
+        try {
+            CopyValues(block->At(0), other.At(0), other.sizeB);
+        }
+        catch (...) {
+            DeleteBlock(block);
+            throw;
+        }
+        block->sizeB = other.sizeB;
+        return block;
+    }
+    void DeleteBlock(ListBlock *block) {
+        DestroyValues(block->At(0), block->sizeB);
+        BlockAlloc blockAlloc(alloc);
+        block_traits::destroy(blockAlloc, block);
+        block_traits::deallocate(blockAlloc, block, 1);
+    }
+    // deep copy other's blocks into this (empty) deque
+    void CopyFrom(const deque &other) {
+        dirValid = false;
+        if (other.sizeD == 0) return;
+        ListBlock *newBlock, *prevBlock;
+        prevBlock = NULL;
+        const ListBlock *origBlock = other.first;
+        try {
+            while (true) {
+                newBlock = CloneBlock(*origBlock);
+                newBlock->prev = prevBlock;
+                if (origBlock == other.first) first = newBlock;
+                if (prevBlock) prevBlock->next = newBlock;
+                prevBlock = newBlock;
+                sizeD += newBlock->sizeB;
+                if (origBlock == other.last) break;
+                origBlock = AsBlock(origBlock->next);
+            }
+        }
+        catch (...) {
+            if (prevBlock) {
+                last = prevBlock;
+                LinkEnd();
+                clear();
+            }
+            throw;
+        }
+        last = newBlock;
+        LinkEnd();
+    }
+    // take other's blocks, leaving it empty; allocators must be compatible
+    void StealFrom(deque &other) {
+        dirValid = other.dirValid = false;
+        sizeD = other.sizeD;
+        first = other.first;
+        last = other.last;
+        LinkEnd();
+        other.sizeD = 0;
+        other.first = other.last = NULL;
+        other.pastTheEnd.prev = NULL;
+    }
+    // point the last block and the sentinel at each other
+    void LinkEnd() {
+        if (sizeD == 0) {
+            first = last = NULL;
+            pastTheEnd.prev = NULL;
+            return;
+        }
+        last->next = &pastTheEnd;
+        pastTheEnd.prev = last;
+    }
 
 public:
 	class const_iterator;
@@ -44,76 +311,34 @@ public:
         friend deque;
 	private:
         deque *ctn;
-        ListBlock *p;
+        BlockHead *p;
         size_t idx;
-        iterator(deque *_ctn, ListBlock *_p, size_t _idx):
+        iterator(deque *_ctn, BlockHead *_p, size_t _idx):
                 ctn(_ctn), p(_p), idx(_idx) {}
 	public:
         iterator(): ctn(NULL), p(NULL), idx(0) {}
         iterator(const iterator &other):
             ctn(other.ctn), p(other.p), idx(other.idx) {}
 		iterator operator+(const int &n) const {
-		    if (n < 0) return operator-(-n);
-            ListBlock *_p = p;
-            size_t _idx = idx;
-            int _n = n;
-            while (_idx + _n >= _p->sizeB && _p != &(ctn->pastTheEnd)) {
-                _n -= _p->sizeB - _idx;
-                _p = _p->next;
-                _idx = 0;
-            }
-            return iterator(ctn, _p, _idx + _n);
+            iterator ret(*this);
+            ctn->Advance(ret.p, ret.idx, n);
+            return ret;
 		}
 		iterator operator-(const int &n) const {
-            if (n < 0) return operator+(-n);
-            ListBlock *_p = p;
-            size_t _idx = idx;
-            int _n = n;
-            while (_idx < _n) {
-                _n -= _idx + 1;
-                _p = _p->prev;
-                _idx = _p->sizeB - 1;
-            }
-            return iterator(ctn, _p, _idx - _n);
+            iterator ret(*this);
+            ctn->Advance(ret.p, ret.idx, -n);
+            return ret;
 		}
 		int operator-(const iterator &rhs) const {
             if (ctn != rhs.ctn) throw invalid_iterator();
-            int order1, order2;
-            ListBlock *_p;
-            order1 = idx;
-            for (_p = p->prev; _p; _p = _p->prev)
-                order1 += _p->sizeB;
-            order2 = rhs.idx;
-            for (_p = (rhs.p)->prev; _p; _p = _p->prev)
-                order2 += _p->sizeB;
-            return order1 - order2;
+            return ctn->GetRank(p, idx) - ctn->GetRank(rhs.p, rhs.idx);
 		}
 		iterator operator+=(const int &n) {
-		    if (n < 0) return operator-=(-n);
-			ListBlock *_p = p;
-            size_t _idx = idx;
-            int _n = n;
-            while (_idx + _n >= _p->sizeB && _p != &(ctn->pastTheEnd)) {
-                _n -= _p->sizeB - _idx;
-                _p = _p->next;
-                _idx = 0;
-            }
-            p = _p;
-            idx = _idx + _n;
+            ctn->Advance(p, idx, n);
             return *this;
 		}
 		iterator operator-=(const int &n) {
-		    if (n < 0) return operator+=(-n);
-			ListBlock *_p = p;
-            size_t _idx = idx;
-            int _n = n;
-            while (_idx < _n) {
-                _n -= _idx + 1;
-                _p = _p->prev;
-                _idx = _p->sizeB - 1;
-            }
-            p = _p;
-            idx = _idx - _n;
+            ctn->Advance(p, idx, -n);
             return *this;
         }
 		iterator operator++(int) {
@@ -155,11 +380,11 @@ public:
             return *this;
         }
 		T& operator*() const {
-		    if (p->data[idx] == NULL) throw invalid_iterator();
-            return *(p->data[idx]);
+		    if (idx >= p->sizeB) throw invalid_iterator();
+            return *(AsBlock(p)->At(idx));
 		}
 		T* operator->() const noexcept {
-            return p->data[idx];
+            return AsBlock(p)->At(idx);
 		}
 		bool operator==(const iterator &rhs) const {
             return (ctn == rhs.ctn) && (p == rhs.p) && (idx == rhs.idx);
@@ -178,9 +403,9 @@ public:
         friend deque;
     private:
         const deque *ctn;
-        const ListBlock *p;
+        const BlockHead *p;
         size_t idx;
-        const_iterator(const deque *_ctn, const ListBlock *_p, size_t _idx):
+        const_iterator(const deque *_ctn, const BlockHead *_p, size_t _idx):
             ctn(_ctn), p(_p), idx(_idx) {}
     public:
         const_iterator(): ctn(NULL), p(NULL), idx(0) {}
@@ -188,68 +413,26 @@ public:
             ctn(other.ctn), p(other.p), idx(other.idx) {}
         const_iterator(const iterator &other):
             ctn(other.ctn), p(other.p), idx(other.idx) {}
-        const_iterator operator+(const int &n) const {
-            if (n < 0) return operator-(-n);
-            const ListBlock *_p = p;
-            size_t _idx = idx;
-            int _n = n;
-            while (_idx + _n >= _p->sizeB && _p != &(ctn->pastTheEnd)) {
-                _n -= _p->sizeB - _idx;
-                _p = _p->next;
-                _idx = 0;
-            }
-            return const_iterator(ctn, _p, _idx + _n);
+		const_iterator operator+(const int &n) const {
+            const_iterator ret(*this);
+            ctn->Advance(ret.p, ret.idx, n);
+            return ret;
 		}
 		const_iterator operator-(const int &n) const {
-            if (n < 0) return operator+(-n);
-            const ListBlock *_p = p;
-            size_t _idx = idx;
-            int _n = n;
-            while (_idx < _n) {
-                _n -= _idx + 1;
-                _p = _p->prev;
-                _idx = _p->sizeB - 1;
-            }
-            return const_iterator(ctn, _p, _idx - _n);
+            const_iterator ret(*this);
+            ctn->Advance(ret.p, ret.idx, -n);
+            return ret;
 		}
 		int operator-(const const_iterator &rhs) const {
             if (ctn != rhs.ctn) throw invalid_iterator();
-            int order1, order2;
-            const ListBlock *_p;
-            order1 = idx;
-            for (_p = p->prev; _p; _p = _p->prev)
-                order1 += _p->sizeB;
-            order2 = rhs.idx;
-            for (_p = (rhs.p)->prev; _p; _p = _p->prev)
-                order2 += _p->sizeB;
-            return order1 - order2;
+            return ctn->GetRank(p, idx) - ctn->GetRank(rhs.p, rhs.idx);
 		}
 		const_iterator operator+=(const int &n) {
-		    if (n < 0) return operator-=(-n);
-			const ListBlock *_p = p;
-            size_t _idx = idx;
-            int _n = n;
-            while (_idx + _n >= _p->sizeB && _p != &(ctn->pastTheEnd)) {
-                _n -= _p->sizeB - _idx;
-                _p = _p->next;
-                _idx = 0;
-            }
-            p = _p;
-            idx = _idx + _n;
+            ctn->Advance(p, idx, n);
             return *this;
 		}
 		const_iterator operator-=(const int &n) {
-		    if (n < 0) return operator+=(-n);
-			const ListBlock *_p = p;
-            size_t _idx = idx;
-            int _n = n;
-            while (_idx < _n) {
-                _n -= _idx + 1;
-                _p = _p->prev;
-                _idx = _p->sizeB - 1;
-            }
-            p = _p;
-            idx = _idx - _n;
+            ctn->Advance(p, idx, -n);
             return *this;
         }
 		const_iterator operator++(int) {
@@ -291,11 +474,11 @@ public:
             return *this;
         }
 		const T& operator*() const {
-		    if (p->data[idx] == NULL) throw invalid_iterator();
-            return *(p->data[idx]);
+		    if (idx >= p->sizeB) throw invalid_iterator();
+            return *(AsBlock(p)->At(idx));
 		}
 		const T* operator->() const noexcept {
-            return p->data[idx];
+            return AsBlock(p)->At(idx);
 		}
 		bool operator==(const iterator &rhs) const {
             return (ctn == rhs.ctn) && (p == rhs.p) && (idx == rhs.idx);
@@ -310,108 +493,98 @@ public:
 		    return (ctn != rhs.ctn) || (p != rhs.p) || (idx != rhs.idx);
 		}
 	};
-	deque(): sizeD(0), first(NULL), last(NULL) {}
-	deque(const deque &other): sizeD(other.sizeD) {
-        if (other.sizeD == 0) {
-            first = last = NULL;
-            return;
-        }
-        ListBlock *newBlock, *prevBlock;
-        prevBlock = NULL;
-        const ListBlock *origBlock = other.first;
-        while (true) {
-            newBlock = new ListBlock(*origBlock);
-            newBlock->prev = prevBlock;
-            if (origBlock == other.first) first = newBlock;
-            if (prevBlock) prevBlock->next = newBlock;
-            prevBlock = newBlock;
-            if (origBlock == other.last) {
-                last = newBlock;
-                break;
-            }
-            origBlock = origBlock->next;
-        }
-        last->next = &pastTheEnd;
-        pastTheEnd.prev = last;
+	deque(): sizeD(0), first(NULL), last(NULL),
+	    dir(NULL), dirSize(0), dirCap(0), dirBase(0), dirValid(false) {}
+	explicit deque(const Allocator &a): alloc(a), sizeD(0), first(NULL), last(NULL),
+	    dir(NULL), dirSize(0), dirCap(0), dirBase(0), dirValid(false) {}
+	deque(const deque &other):
+	    alloc(alloc_traits::select_on_container_copy_construction(other.alloc)),
+	    sizeD(0), first(NULL), last(NULL),
+	    dir(NULL), dirSize(0), dirCap(0), dirBase(0), dirValid(false) {
+        CopyFrom(other);
     }
+	deque(deque &&other): alloc(std::move(other.alloc)),
+	    dir(NULL), dirSize(0), dirCap(0), dirBase(0), dirValid(false) {
+        StealFrom(other);
+	}
 	~deque() {
         clear();
+        FreeDir();
 	}
 	deque &operator=(const deque &other) {
         if (this == &other) return *this;
         clear();
-        sizeD = other.sizeD;
-        if (other.sizeD == 0) {
-            first = last = NULL;
-            return *this;
+        if (alloc_traits::propagate_on_container_copy_assignment::value) {
+            // the directory goes back to the allocator that made it
+            FreeDir();
+            alloc = other.alloc;
         }
-        ListBlock *newBlock, *prevBlock;
-        prevBlock = NULL;
-        const ListBlock *origBlock = other.first;
-        while (true) {
-            newBlock = new ListBlock(*origBlock);
-            newBlock->prev = prevBlock;
-            if (origBlock == other.first) first = newBlock;
-            if (prevBlock) prevBlock->next = newBlock;
-            prevBlock = newBlock;
-            if (origBlock == other.last) {
-                last = newBlock;
-                break;
-            }
-            origBlock = origBlock->next;
-        }
-        last->next = &pastTheEnd;
-        pastTheEnd.prev = last;
+        CopyFrom(other);
 	    return *this;
     }
+	deque &operator=(deque &&other) {
+        if (this == &other) return *this;
+        clear();
+        if (alloc_traits::propagate_on_container_move_assignment::value) {
+            FreeDir();
+            alloc = std::move(other.alloc);
+            StealFrom(other);
+        }
+        else if (alloc == other.alloc) StealFrom(other);
+        else {
+            // blocks from a foreign allocator must be rebuilt with ours
+            CopyFrom(other);
+            other.clear();
+        }
+        return *this;
+	}
+	void swap(deque &other) {
+        if (alloc_traits::propagate_on_container_swap::value)
+            std::swap(alloc, other.alloc);
+        std::swap(sizeD, other.sizeD);
+        std::swap(first, other.first);
+        std::swap(last, other.last);
+        // each directory stays with the allocator that made it
+        std::swap(dir, other.dir);
+        std::swap(dirCap, other.dirCap);
+        dirValid = other.dirValid = false;
+        LinkEnd();
+        other.LinkEnd();
+	}
+	allocator_type get_allocator() const {
+        return alloc;
+	}
 	T & at(const size_t &posOrig) {
 	    size_t pos = posOrig;
         if (pos < 0 || pos >= sizeD) throw index_out_of_bound();
-        ListBlock *nowBlock = first;
-        while (pos >= nowBlock->sizeB) {
-            pos -= nowBlock->sizeB;
-            nowBlock = nowBlock->next;
-        }
-        return *(nowBlock->data[pos]);
+        ListBlock *nowBlock = Locate(pos);
+        return *(nowBlock->At(pos));
 	}
 	const T & at(const size_t &posOrig) const {
 	    size_t pos = posOrig;
         if (pos < 0 || pos >= sizeD) throw index_out_of_bound();
-        const ListBlock *nowBlock = first;
-        while (pos >= nowBlock->sizeB) {
-            pos -= nowBlock->sizeB;
-            nowBlock = nowBlock->next;
-        }
-        return *(nowBlock->data[pos]);
+        const ListBlock *nowBlock = Locate(pos);
+        return *(nowBlock->At(pos));
 	}
 	T & operator[](const size_t &posOrig) {
 	    size_t pos = posOrig;
         if (pos < 0 || pos >= sizeD) throw index_out_of_bound();
-        int idx = pos;
-        ListBlock *nowBlock = first;
-        while (idx >= nowBlock->sizeB) {
-            idx -= nowBlock->sizeB;
-            nowBlock = nowBlock->next;
-        }
-        return *(nowBlock->data[idx]);
+        ListBlock *nowBlock = Locate(pos);
+        return *(nowBlock->At(pos));
 	}
 	const T & operator[](const size_t &posOrig) const {
 	    size_t pos = posOrig;
         if (pos < 0 || pos >= sizeD) throw index_out_of_bound();
-        const ListBlock *nowBlock = first;
-        while (pos >= nowBlock->sizeB) {
-            pos -= nowBlock->sizeB;
-            nowBlock = nowBlock->next;
-        }
-        return *(nowBlock->data[pos]);
+        const ListBlock *nowBlock = Locate(pos);
+        return *(nowBlock->At(pos));
 	}
 	const T & front() const {
         if (sizeD == 0) throw container_is_empty();
-        return *(first->data[0]);
+        return *(first->At(0));
 	}
 	const T & back() const {
         if (sizeD == 0) throw container_is_empty();
-        return *(last->data[last->sizeB - 1]);
+        return *(last->At(last->sizeB - 1));
 	}
 	iterator begin() {
         if (sizeD == 0) return iterator(this, &pastTheEnd, 0);
@@ -435,100 +608,123 @@ public:
 	}
 	void clear() {
         if (sizeD == 0) return;
-        ListBlock *nowBlock = first, *tmp;
+        BlockHead *nowBlock = first;
+        // arena allocators drop every block at once; nothing to visit
+        if (skips_deallocate(alloc) && std::is_trivially_destructible<T>::value)
+            nowBlock = &pastTheEnd;
         while (nowBlock != &pastTheEnd) {
-            tmp = nowBlock;
+            ListBlock *tmp = AsBlock(nowBlock);
             nowBlock = nowBlock->next;
-            delete tmp;
+            DeleteBlock(tmp);
         }
-        pastTheEnd.prev = NULL;
+        dirValid = false;
         sizeD = 0;
+        LinkEnd();
 	}
 private:
-    int GetRank(const ListBlock *p, int idx) const {
-        int ret = idx;
-        while (p != first) {
-            p = p->prev;
-            ret += p->sizeB;
-        }
-        return ret;
-    }
     iterator GetByRank(int k) {
-        ListBlock *nowBlock = first;
-        while (k >= nowBlock->sizeB && nowBlock != &pastTheEnd) {
-            k -= nowBlock->sizeB;
-            nowBlock = nowBlock->next;
-        }
-        return iterator(this, nowBlock, k);
+        if ((size_t)k >= sizeD) return iterator(this, &pastTheEnd, k - sizeD);
+        size_t idx = k;
+        ListBlock *nowBlock = Locate(idx);
+        return iterator(this, nowBlock, idx);
     }
-    bool Mergeable(ListBlock *lBlock, ListBlock *rBlock) {
+    bool Mergeable(const ListBlock *lBlock, const BlockHead *rBlock) {
         if (lBlock == NULL || rBlock == NULL || rBlock == &pastTheEnd) return false;
         return lBlock->sizeB + rBlock->sizeB <= maxBlockSize;
     }
+    // the elements are relocated, not copied: the blocks only change owners
     void MergeBlock(ListBlock *lBlock, ListBlock *rBlock) {
-        for (int i = 0; i < rBlock->sizeB; ++i)
-            lBlock->data[lBlock->sizeB + i] = new T(*(rBlock->data[i]));
+        relocate(alloc, lBlock->At(lBlock->sizeB), rBlock->At(0), rBlock->sizeB);
         lBlock->sizeB += rBlock->sizeB;
+        rBlock->sizeB = 0;
+        DirUnlink(rBlock, 0);
         if (rBlock == last) last = lBlock;
         lBlock->next = rBlock->next;
         if (lBlock->next) lBlock->next->prev = lBlock;
-        delete rBlock;
+        DeleteBlock(rBlock);
     }
     ListBlock* SplitBlock(ListBlock *block, int idx) {
-        ListBlock *newBlock = new ListBlock;
-        newBlock->sizeB = block->sizeB - idx;
-        for (int i = 0; i < newBlock->sizeB; ++i)
-            newBlock->data[i] = new T(*(block->data[idx + i]));
-        for (int i = idx; i < block->sizeB; ++i) {
-            delete block->data[i];
-            block->data[i] = NULL;
-        }
-        block->sizeB -= newBlock->sizeB;
+        ListBlock *newBlock = NewBlock();
+        int cnt = block->sizeB - idx;
+        try {
+            relocate(alloc, newBlock->At(0), block->At(idx), cnt);
+        }
+        catch (...) {
+            DeleteBlock(newBlock);
+            throw;
+        }
+        newBlock->sizeB = cnt;
+        block->sizeB -= cnt;
         if (block == last) last = newBlock;
         newBlock->next = block->next;
         if (newBlock->next) newBlock->next->prev = newBlock;
         newBlock->prev = block;
         block->next = newBlock;
+        DirLink(newBlock, 0);
         return block;
     }
+    // a failed shift leaves block's elements from idx on raw: drop them
+    void Truncate(ListBlock *block, int idx) {
+        int lost = block->sizeB - idx;
+        block->sizeB = idx;
+        sizeD -= lost;
+        Resized(block, -lost);
+    }
     void DeleteElement(ListBlock *block, int idx) {
-        delete block->data[idx];
-        for (int i = idx; i < block->sizeB - 1; ++i)
-            block->data[i] = block->data[i + 1];
-        block->data[block->sizeB - 1] = NULL;
+        alloc_traits::destroy(alloc, block->At(idx));
+        try {
+            shift(alloc, block->At(idx), block->At(idx + 1), block->sizeB - idx - 1);
+        }
+        catch (...) {
+            --(block->sizeB);
+            Truncate(block, idx);
+            throw;
+        }
         --(block->sizeB);
+        Resized(block, -1);
     }
+    // insert has already counted value in sizeD
     void InsertElement(ListBlock *block, int idx, const T &value) {
+        // value may live in this block: copy it before the shift moves it
+        temp_value<Allocator, T> tmp(alloc, value);
+        try {
+            shift_in(alloc, block->At(idx), block->sizeB - idx, tmp);
+        }
+        catch (...) {
+            --sizeD;
+            Truncate(block, idx);
+            throw;
+        }
         ++(block->sizeB);
-        for (int i = block->sizeB - 1; i > idx; --i)
-            block->data[i] = block->data[i - 1];
-        block->data[idx] = new T(value);
+        Resized(block, 1);
     }
 public:
 	iterator insert(iterator pos, const T &value) {
         if (pos.ctn != this || pos.p == NULL) throw invalid_iterator();
         ++sizeD;
         if (sizeD == 1) {
-            ListBlock *newBlock = new ListBlock(value);
+            ListBlock *newBlock = NewBlock(value);
             first = last = newBlock;
             newBlock->prev = NULL;
             newBlock->next = &pastTheEnd;
             pastTheEnd.prev = newBlock;
+            DirLink(newBlock, 1);
             return begin();
         }
         if (pos.p != &pastTheEnd && (pos.p)->sizeB + 1 <= maxBlockSize) {
-            InsertElement(pos.p, pos.idx, value);
+            InsertElement(AsBlock(pos.p), pos.idx, value);
             return pos;
         }
         int rankNew = GetRank(pos.p, pos.idx);
-        ListBlock *newBlock = new ListBlock(value);
-        ListBlock *prevBlock, *nextBlock;
+        ListBlock *newBlock = NewBlock(value);
+        ListBlock *prevBlock;
+        BlockHead *nextBlock;
         if (pos.idx == 0) {
             prevBlock = (pos.p)->prev;
             nextBlock = pos.p;
         }
         else {
-            prevBlock = SplitBlock(pos.p, pos.idx);
+            prevBlock = SplitBlock(AsBlock(pos.p), pos.idx);
             nextBlock = prevBlock->next;
         }
         if (prevBlock == NULL) {
@@ -542,8 +738,9 @@ public:
         if (nextBlock == &pastTheEnd) last = newBlock;
         newBlock->next = nextBlock;
         nextBlock->prev = newBlock;
+        DirLink(newBlock, 1);
         if (Mergeable(prevBlock, newBlock)) MergeBlock(prevBlock, newBlock);
-        if (Mergeable(nextBlock->prev, nextBlock)) MergeBlock(nextBlock->prev, nextBlock);
+        if (Mergeable(nextBlock->prev, nextBlock)) MergeBlock(nextBlock->prev, AsBlock(nextBlock));
         return GetByRank(rankNew);
     }
 	iterator erase(iterator pos) {
@@ -551,56 +748,59 @@ public:
         if (pos.ctn != this || pos.p == NULL || pos.p->sizeB == 0) throw invalid_iterator();
         --sizeD;
         if (sizeD == 0) {
-            delete first;
+            DirUnlink(first, 1);
+            DeleteBlock(first);
             first = last = NULL;
             pastTheEnd.prev = NULL;
             return end();
         }
         int rankNew = GetRank(pos.p, pos.idx);
-        ListBlock *prevBlock, *nextBlock;
-        if (pos.p->sizeB == 1) {
-            prevBlock = pos.p->prev;
-            nextBlock = pos.p->next;
-            if (pos.p == first) first = nextBlock;
-            if (pos.p == last) last = prevBlock;
+        ListBlock *block = AsBlock(pos.p), *prevBlock = block->prev;
+        BlockHead *nextBlock = block->next;
+        if (block->sizeB == 1) {
+            // the sentinel cannot follow: the deque would now be empty
+            if (block == first) first = AsBlock(nextBlock);
+            if (block == last) last = prevBlock;
             if (prevBlock) prevBlock->next = nextBlock;
             if (nextBlock) nextBlock->prev = prevBlock;
-            delete pos.p;
-            if (Mergeable(prevBlock, nextBlock)) MergeBlock(prevBlock, nextBlock);
+            DirUnlink(block, 1);
+            DeleteBlock(block);
+            if (Mergeable(prevBlock, nextBlock)) MergeBlock(prevBlock, AsBlock(nextBlock));
         }
         else {
-            prevBlock = pos.p->prev;
-            nextBlock = pos.p->next;
-            DeleteElement(pos.p, pos.idx);
-            if (Mergeable(prevBlock, pos.p)) MergeBlock(prevBlock, pos.p);
-            else if (Mergeable(pos.p, nextBlock)) MergeBlock(pos.p, nextBlock);
+            DeleteElement(block, pos.idx);
+            if (Mergeable(prevBlock, block)) MergeBlock(prevBlock, block);
+            else if (Mergeable(block, nextBlock)) MergeBlock(block, AsBlock(nextBlock));
         }
         return GetByRank(rankNew);
 	}
 	void push_back(const T &value) {
 	    ++sizeD;
 	    if (sizeD == 1) {
-            ListBlock *newBlock = new ListBlock(value);
+            ListBlock *newBlock = NewBlock(value);
             first = last = newBlock;
             newBlock->next = &pastTheEnd;
             pastTheEnd.prev = newBlock;
+            DirLink(newBlock, 1);
             return;
 	    }
 	    if (last->sizeB + 1 <= maxBlockSize) InsertElement(last, last->sizeB, value);
 	    else {
-            ListBlock *newBlock = new ListBlock(value);
+            ListBlock *newBlock = NewBlock(value);
             newBlock->prev = last;
             newBlock->next = &pastTheEnd;
             pastTheEnd.prev = newBlock;
             last->next = newBlock;
             last = newBlock;
+            DirLink(newBlock, 1);
 	    }
 	}
 	void pop_back() {
         if (sizeD == 0) throw container_is_empty();
         --sizeD;
         if (sizeD == 0) {
-            delete first;
+            DirUnlink(first, 1);
+            DeleteBlock(first);
             first = last = NULL;
             pastTheEnd.prev = NULL;
             return;
@@ -608,7 +808,8 @@ public:
         if (last->sizeB == 1) {
             if (last->prev) last->prev->next = last->next;
             if (last->next) last->next->prev = last->prev;
-            delete last;
+            DirUnlink(last, 1);
+            DeleteBlock(last);
             last = pastTheEnd.prev;
         }
         else DeleteElement(last, last->sizeB - 1);
@@ -616,34 +817,38 @@ public:
 	void push_front(const T &value) {
 	    ++sizeD;
 	    if (sizeD == 1) {
-            ListBlock *newBlock = new ListBlock(value);
+            ListBlock *newBlock = NewBlock(value);
             first = last = newBlock;
             newBlock->next = &pastTheEnd;
             pastTheEnd.prev = newBlock;
+            DirLink(newBlock, 1);
             return;
 	    }
         if (first->sizeB + 1 <= maxBlockSize) InsertElement(first, 0, value);
         else {
-            ListBlock *newBlock = new ListBlock(value);
+            ListBlock *newBlock = NewBlock(value);
             newBlock->next = first;
             first->prev = newBlock;
             first = newBlock;
+            DirLink(newBlock, 1);
         }
 	}
 	void pop_front() {
         if (sizeD == 0) throw container_is_empty();
         --sizeD;
         if (sizeD == 0) {
-            delete first;
+            DirUnlink(first, 1);
+            DeleteBlock(first);
             first = last = 0;
             pastTheEnd.prev = NULL;
             return;
         }
         if (first->sizeB == 1) {
             ListBlock *tmp = first;
-            first = first->next;
+            first = AsBlock(first->next);
             first->prev = NULL;
-            delete tmp;
+            DirUnlink(tmp, 1);
+            DeleteBlock(tmp);
         }
         else DeleteElement(first, 0);
 	}
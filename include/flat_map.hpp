@@ -0,0 +1,319 @@
+#ifndef SJTU_FLAT_MAP_HPP
+#define SJTU_FLAT_MAP_HPP
+
+#include <algorithm>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <utility>
+#include "utility.hpp"
+#include "exceptions.hpp"
+#include "vector.hpp"
+
+namespace sjtu {
+
+/**
+ * Sorted-array map for tables that are built once and read many times.
+ * Keys and values live in two sjtu::vectors kept in key order, so a
+ * lookup is a binary search over contiguous keys.  insert and erase shift
+ * the arrays (O(n)) and invalidate iterators; build from a whole range
+ * instead, which costs one sort.  Lookups mirror sjtu::map: find, at,
+ * count, operator[] and getByRank.
+ *
+ * Iterators yield pair<const Key&, T&> by value; it->first and
+ * it->second work as with map.
+ */
+template<
+	class Key,
+	class T,
+	class Compare = std::less<Key>,
+	class Allocator = std::allocator<pair<const Key, T>>
+> class flat_map {
+public:
+    typedef pair<const Key, T> value_type;
+    typedef pair<const Key&, T&> reference;
+    typedef pair<const Key&, const T&> const_reference;
+    typedef Allocator allocator_type;
+private:
+    typedef std::allocator_traits<Allocator> alloc_traits;
+    typedef typename alloc_traits::template rebind_alloc<Key> KeyAlloc;
+    typedef typename alloc_traits::template rebind_alloc<T> ValueAlloc;
+    typedef typename alloc_traits::template rebind_alloc<size_t> IndexAlloc;
+    typedef std::allocator_traits<IndexAlloc> index_traits;
+
+    Compare CmpKey;
+    vector<Key, KeyAlloc> keys;
+    vector<T, ValueAlloc> vals;
+
+    // first position whose key is not less than key
+    size_t LowerBound(const Key &key) const {
+        size_t lo = 0, hi = keys.size();
+        while (lo < hi) {
+            size_t mid = (lo + hi) >> 1;
+            if (CmpKey(keys[mid], key)) lo = mid + 1;
+            else hi = mid;
+        }
+        return lo;
+    }
+    // position of key, or size() if it is absent
+    size_t Find(const Key &key) const {
+        size_t idx = LowerBound(key);
+        if (idx == keys.size() || CmpKey(key, keys[idx])) return keys.size();
+        return idx;
+    }
+    // put the pairs appended in input order into key order, keeping the
+    // first of each run of equal keys like repeated insert would
+    void SortUnique() {
+        size_t n = keys.size();
+        if (n == 0) return;
+        IndexAlloc indexAlloc(keys.get_allocator());
+        size_t *order = index_traits::allocate(indexAlloc, n);
+        try {
+            for (size_t i = 0; i < n; ++i) order[i] = i;
+            std::stable_sort(order, order + n, [this](size_t a, size_t b) {
+                return CmpKey(keys[a], keys[b]);
+            });
+            vector<Key, KeyAlloc> sortedKeys(keys.get_allocator());
+            vector<T, ValueAlloc> sortedVals(vals.get_allocator());
+            sortedKeys.reserve(n);
+            sortedVals.reserve(n);
+            for (size_t i = 0; i < n; ++i) {
+                if (i > 0 && !CmpKey(sortedKeys.back(), keys[order[i]])) continue;
+                sortedKeys.push_back(std::move(keys[order[i]]));
+                sortedVals.push_back(std::move(vals[order[i]]));
+            }
+            keys.swap(sortedKeys);
+            vals.swap(sortedVals);
+        }
+        catch (...) {
+            index_traits::deallocate(indexAlloc, order, n);
+            clear();
+            throw;
+        }
+        index_traits::deallocate(indexAlloc, order, n);
+    }
+
+public:
+	class const_iterator;
+	class iterator {
+	    friend class flat_map;
+	    friend class const_iterator;
+	private:
+	    flat_map *ctn;
+	    size_t idx;
+	    iterator(flat_map *ctnA, size_t idxA): ctn(ctnA), idx(idxA) {}
+	public:
+	    // what operator-> hands out: holds the pair so its address stays valid
+	    struct pointer {
+	        reference ref;
+	        reference *operator->() {
+	            return &ref;
+	        }
+	    };
+		iterator(): ctn(NULL), idx(0) {}
+		iterator(const iterator &other): ctn(other.ctn), idx(other.idx) {}
+		iterator operator++(int) {
+            iterator tmp(*this);
+            ++*this;
+            return tmp;
+		}
+		iterator & operator++() {
+            if (ctn == NULL || idx >= ctn -> keys.size()) throw invalid_iterator();
+            ++idx;
+            return *this;
+		}
+		iterator operator--(int) {
+            iterator tmp(*this);
+            --*this;
+            return tmp;
+		}
+		iterator & operator--() {
+            if (idx == 0) throw invalid_iterator();
+            --idx;
+            return *this;
+		}
+		reference operator*() const {
+            if (ctn == NULL || idx >= ctn -> keys.size()) throw invalid_iterator();
+            return reference(ctn -> keys[idx], ctn -> vals[idx]);
+		}
+		pointer operator->() const {
+            pointer ret = {**this};
+            return ret;
+		}
+		bool operator==(const iterator &rhs) const {
+            return (ctn == rhs.ctn) && (idx == rhs.idx);
+		}
+		bool operator==(const const_iterator &rhs) const {
+            return (ctn == rhs.ctn) && (idx == rhs.idx);
+		}
+		bool operator!=(const iterator &rhs) const {
+            return (ctn != rhs.ctn) || (idx != rhs.idx);
+		}
+		bool operator!=(const const_iterator &rhs) const {
+		    return (ctn != rhs.ctn) || (idx != rhs.idx);
+		}
+	};
+	class const_iterator {
+        friend class flat_map;
+        friend class iterator;
+    private:
+        const flat_map *ctn;
+        size_t idx;
+        const_iterator(const flat_map *ctnA, size_t idxA): ctn(ctnA), idx(idxA) {}
+    public:
+	    struct pointer {
+	        const_reference ref;
+	        const_reference *operator->() {
+	            return &ref;
+	        }
+	    };
+        const_iterator(): ctn(NULL), idx(0) {}
+        const_iterator(const const_iterator &other): ctn(other.ctn), idx(other.idx) {}
+        const_iterator(const iterator &other): ctn(other.ctn), idx(other.idx) {}
+        const_iterator operator++(int) {
+            const_iterator tmp(*this);
+            ++*this;
+            return tmp;
+		}
+		const_iterator & operator++() {
+            if (ctn == NULL || idx >= ctn -> keys.size()) throw invalid_iterator();
+            ++idx;
+            return *this;
+		}
+		const_iterator operator--(int) {
+            const_iterator tmp(*this);
+            --*this;
+            return tmp;
+		}
+		const_iterator & operator--() {
+            if (idx == 0) throw invalid_iterator();
+            --idx;
+            return *this;
+		}
+		const_reference operator*() const {
+            if (ctn == NULL || idx >= ctn -> keys.size()) throw invalid_iterator();
+            return const_reference(ctn -> keys[idx], ctn -> vals[idx]);
+		}
+		pointer operator->() const {
+            pointer ret = {**this};
+            return ret;
+		}
+		bool operator==(const iterator &rhs) const {
+            return (ctn == rhs.ctn) && (idx == rhs.idx);
+		}
+		bool operator==(const const_iterator &rhs) const {
+            return (ctn == rhs.ctn) && (idx == rhs.idx);
+		}
+		bool operator!=(const iterator &rhs) const {
+            return (ctn != rhs.ctn) || (idx != rhs.idx);
+		}
+		bool operator!=(const const_iterator &rhs) const {
+		    return (ctn != rhs.ctn) || (idx != rhs.idx);
+		}
+	};
+
+	flat_map() {}
+	explicit flat_map(const Allocator &a): keys(KeyAlloc(a)), vals(ValueAlloc(a)) {}
+	// bulk build from pairs in any order; of equal keys the first one wins
+	template<class InputIt>
+	flat_map(InputIt first, InputIt last, const Allocator &a = Allocator()):
+	    keys(KeyAlloc(a)), vals(ValueAlloc(a)) {
+        for (; first != last; ++first) {
+            keys.push_back((*first).first);
+            vals.push_back((*first).second);
+        }
+        SortUnique();
+	}
+	void swap(flat_map &other) {
+        std::swap(CmpKey, other.CmpKey);
+        keys.swap(other.keys);
+        vals.swap(other.vals);
+	}
+	allocator_type get_allocator() const {
+        return allocator_type(keys.get_allocator());
+	}
+
+	T & at(const Key &key) {
+        size_t idx = Find(key);
+        if (idx == keys.size()) throw index_out_of_bound();
+        return vals[idx];
+	}
+	const T & at(const Key &key) const {
+        size_t idx = Find(key);
+        if (idx == keys.size()) throw index_out_of_bound();
+        return vals[idx];
+	}
+	T & operator[](const Key &key) {
+        size_t idx = Find(key);
+        if (idx < keys.size()) return vals[idx];
+        return insert(value_type(key, T())).first -> second;
+	}
+	const T & operator[](const Key &key) const {
+        return at(key);
+	}
+
+	iterator begin() {
+        return iterator(this, 0);
+    }
+	const_iterator cbegin() const {
+        return const_iterator(this, 0);
+	}
+	iterator end() {
+        return iterator(this, keys.size());
+	}
+	const_iterator cend() const {
+        return const_iterator(this, keys.size());
+	}
+	bool empty() const {
+        return keys.empty();
+	}
+	size_t size() const {
+        return keys.size();
+	}
+	void clear() {
+        keys.clear();
+        vals.clear();
+	}
+	pair<iterator, bool> insert(const value_type &value) {
+        size_t idx = LowerBound(value.first);
+        if (idx < keys.size() && !CmpKey(value.first, keys[idx]))
+            return pair<iterator, bool>(iterator(this, idx), false);
+        keys.insert(idx, value.first);
+        try {
+            vals.insert(idx, value.second);
+        }
+        catch (...) {
+            keys.erase(idx);
+            throw;
+        }
+        return pair<iterator, bool>(iterator(this, idx), true);
+	}
+	void erase(iterator pos) {
+        if (pos.ctn != this || pos.idx >= keys.size()) throw index_out_of_bound();
+        keys.erase(pos.idx);
+        vals.erase(pos.idx);
+	}
+
+	size_t count(const Key &key) const {
+        return Find(key) == keys.size() ? 0 : 1;
+	}
+	iterator find(const Key &key) {
+        return iterator(this, Find(key));
+	}
+	const_iterator find(const Key &key) const {
+        return const_iterator(this, Find(key));
+	}
+
+    iterator getByRank(int k) {
+        if (k <= 0 || size_t(k) > keys.size()) throw index_out_of_bound();
+        return iterator(this, k - 1);
+    }
+    const_iterator getByRank(int k) const {
+        if (k <= 0 || size_t(k) > keys.size()) throw index_out_of_bound();
+        return const_iterator(this, k - 1);
+    }
+};
+
+}
+
+#endif
@@ -3,56 +3,170 @@
 
 // only for std::less<T>
 #include <functional>
+#include <algorithm>
 #include <cstddef>
+#include <limits>
+#include <memory>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#if __cplusplus > 201703L && defined(__cpp_impl_three_way_comparison)
+#include <compare>
+#endif
 #include "utility.hpp"
 #include "exceptions.hpp"
 
 namespace sjtu {
 
-template<class T>
-inline T gmax(const T &a, const T &b) {
-    return a > b ? a : b;
-}
-template<class T>
-inline T gmin(const T &a, const T &b) {
-    return a < b ? a : b;
-}
+// tree layouts for sjtu::map; the B-tree one lives in btree_map.hpp
+struct avl_policy {};
+struct btree_policy {};
+
+/**
+ * AVL map whose nodes also keep Op's fold of the mapped values below them,
+ * for aggregate(lo, hi) in O(log n).  Op is default constructed where it
+ * is needed and provides
+ *     typedef ... value_type;   // built from a mapped value T
+ *     value_type identity() const;
+ *     value_type operator()(const value_type &a, const value_type &b) const;
+ * where operator() is associative; it need not commute.
+ */
+template<class Op>
+struct augmented_policy {};
+
+template<class V>
+struct agg_sum {
+    typedef V value_type;
+    V identity() const {
+        return V();
+    }
+    V operator()(const V &a, const V &b) const {
+        return a + b;
+    }
+};
+template<class V>
+struct agg_min {
+    typedef V value_type;
+    V identity() const {
+        return std::numeric_limits<V>::max();
+    }
+    V operator()(const V &a, const V &b) const {
+        return gmin(a, b);
+    }
+};
+template<class V>
+struct agg_max {
+    typedef V value_type;
+    V identity() const {
+        return std::numeric_limits<V>::lowest();
+    }
+    V operator()(const V &a, const V &b) const {
+        return gmax(a, b);
+    }
+};
+
+// the Op of an augmented policy, void for the others
+template<class Policy>
+struct AugmentOf {
+    typedef void type;
+};
+template<class Op>
+struct AugmentOf<augmented_policy<Op>> {
+    typedef Op type;
+};
+// what an AVL node stores for its augmentation: nothing without one
+template<class Op>
+struct AggSlot {
+    typedef typename Op::value_type type;
+    type agg;
+    template<class Value, class Node>
+    void Fold(const Value *v, const Node *l, const Node *r) {
+        Op op;
+        agg = type(v -> second);
+        if (l) agg = op(l -> agg, agg);
+        if (r) agg = op(agg, r -> agg);
+    }
+};
+template<>
+struct AggSlot<void> {
+    typedef void type;
+    template<class Value, class Node>
+    void Fold(const Value *, const Node *, const Node *) {}
+};
+
+/**
+ * Whether Compare can order an A against a B in one call.  It can if it
+ * has a member compare(a, b) that is negative, zero or positive as a goes
+ * before, with or after b, or, under C++20, if it is std::less<> and
+ * a <=> b is defined.  Lookups in sjtu::map then make one comparison per
+ * node and stop as soon as they hit the key.  std::less<A> keeps using
+ * operator<, which A's operator<=> need not agree with; specialize
+ * three_way for it (deriving from SpaceshipOrder<A, A>) to opt in.
+ */
+template<class Compare, class A, class B, class = void>
+struct three_way {
+    static const bool value = false;
+};
+template<class Compare, class A, class B>
+struct three_way<Compare, A, B, decltype(void(std::declval<const Compare &>().compare(std::declval<const A &>(), std::declval<const B &>())))> {
+    static const bool value = true;
+    static int compare(const Compare &cmp, const A &a, const B &b) {
+        return cmp.compare(a, b);
+    }
+};
+#if defined(__cpp_lib_three_way_comparison)
+template<class A, class B>
+struct SpaceshipOrder {
+    static const bool value = true;
+    template<class C>
+    static int compare(const C &, const A &a, const B &b) {
+        auto c = a <=> b;
+        return c < 0 ? -1 : (c == 0 ? 0 : 1);
+    }
+};
+// transparent std::less<> orders through <=> wherever it is defined
+template<class A, class B> requires std::three_way_comparable_with<A, B>
+struct three_way<std::less<>, A, B, void> : SpaceshipOrder<A, B> {};
+#endif
 
 template<
 	class Key,
 	class T,
-	class Compare = std::less<Key>
+	class Compare = std::less<Key>,
+	class Allocator = std::allocator<pair<const Key, T>>,
+	class Policy = avl_policy
 > class map {
 public:
     typedef pair<const Key, T> value_type;
+    typedef Allocator allocator_type;
 private:
     Compare CmpKey;
     bool CmpValue(const value_type &a, const value_type &b) const {
         return CmpKey(a.first, b.first);
     }
-    bool EqualKey(const Key &a, const Key &b) const {
-        return !(CmpKey(a, b) || CmpKey(b, a));
+    template<class K>
+    struct ThreeWay : std::integral_constant<bool, three_way<Compare, Key, K>::value> {};
+    // a stored key against key: negative, zero or positive
+    template<class K>
+    int Cmp3(const Key &a, const K &key, std::true_type) const {
+        return three_way<Compare, Key, K>::compare(CmpKey, a, key);
+    }
+    template<class K>
+    int Cmp3(const Key &a, const K &key, std::false_type) const {
+        if (CmpKey(a, key)) return -1;
+        return CmpKey(key, a) ? 1 : 0;
     }
-    struct AvlTree {
+    typedef typename AugmentOf<Policy>::type AugOp;
+    typedef AggSlot<AugOp> Slot;
+    static const bool augmented = !std::is_void<AugOp>::value;
+    struct AvlTree : Slot {
         size_t sizeT;
         int h;
-        value_type *v;
-        AvlTree *l, *r, *prev, *next;
+        value_type *v;  // points at val, or NULL in the end sentinel
+        AvlTree *l, *r, *fa, *prev, *next;  // fa is NULL at the root
+        typename std::aligned_storage<sizeof(value_type), alignof(value_type)>::type val;
         AvlTree():
-            v(NULL), sizeT(1), h(0), l(NULL), r(NULL), prev(NULL), next(NULL) {}
-        AvlTree(const value_type &e):
-            sizeT(1), h(0), l(NULL), r(NULL), prev(NULL), next(NULL) {
-            v = new value_type(e);
-        }
-        AvlTree(const AvlTree &other):
-            sizeT(other.sizeT), h(other.h), prev(NULL), next(NULL) {
-            if (other.l) l = new AvlTree(*(other.l));
-            else l = NULL;
-            if (other.r) r = new AvlTree(*(other.r));
-            else r = NULL;
-            if (other.v) v = new value_type(*other.v);
-            else v = NULL;
-        }
+            v(NULL), sizeT(1), h(0), l(NULL), r(NULL), fa(NULL), prev(NULL), next(NULL) {}
         size_t GetSizeT(const AvlTree *p) {
             if (!p) return 0;
             return p -> sizeT;
@@ -61,36 +175,256 @@ private:
             if (!p) return -1;
             return p -> h;
         }
+        // recompute from the children and claim them
         void Update() {
             sizeT = GetSizeT(l) + GetSizeT(r) + 1;
             h = gmax(GetH(l), GetH(r)) + 1;
-        }
-        ~AvlTree() {
-            if (v) delete v;
-            v = NULL;
-            if (l) delete l;
-            if (r) delete r;
+            if (l) l -> fa = this;
+            if (r) r -> fa = this;
+            this -> Fold(v, l, r);
         }
     };
+    // nodes are carved out of chunks that live until the map is cleared
+    struct PoolChunk {
+        AvlTree *nodes;
+        size_t cnt;
+        PoolChunk *next;
+    };
+    // maps split from one another share their pool; the last one frees it
+    struct NodePool {
+        PoolChunk *chunks;
+        AvlTree *freeNodes;  // chained through next
+        AvlTree *freeTail;   // the last free node; stale while there is none
+        size_t poolNodes, refs;
+    };
+    static const size_t minChunkNodes = 16, maxChunkNodes = 4096;
+    typedef std::allocator_traits<Allocator> alloc_traits;
+    typedef typename alloc_traits::template rebind_alloc<AvlTree> NodeAlloc;
+    typedef std::allocator_traits<NodeAlloc> node_traits;
+    typedef typename alloc_traits::template rebind_alloc<PoolChunk> ChunkAlloc;
+    typedef std::allocator_traits<ChunkAlloc> chunk_traits;
+    typedef typename alloc_traits::template rebind_alloc<NodePool> PoolAlloc;
+    typedef std::allocator_traits<PoolAlloc> pool_traits;
+    typedef typename alloc_traits::template rebind_alloc<AvlTree*> PtrAlloc;
+    typedef std::allocator_traits<PtrAlloc> ptr_traits;
+
+    Allocator alloc;
+    NodePool *pool;  // NULL until the first node is needed
+
+    // add a chunk of at least cnt nodes to the free list
+    void GrowPool(size_t cnt) {
+        NodeAlloc nodeAlloc(alloc);
+        ChunkAlloc chunkAlloc(alloc);
+        if (pool == NULL) {
+            PoolAlloc poolAlloc(alloc);
+            pool = pool_traits::allocate(poolAlloc, 1);
+            pool -> chunks = NULL;
+            pool -> freeNodes = pool -> freeTail = NULL;
+            pool -> poolNodes = 0;
+            pool -> refs = 1;
+        }
+        PoolChunk *chunk = chunk_traits::allocate(chunkAlloc, 1);
+        try {
+            chunk -> nodes = node_traits::allocate(nodeAlloc, cnt);
+        }
+        catch (...) {
+            chunk_traits::deallocate(chunkAlloc, chunk, 1);
+            throw;
+        }
+        chunk -> cnt = cnt;
+        chunk -> next = pool -> chunks;
+        pool -> chunks = chunk;
+        pool -> poolNodes += cnt;
+        if (pool -> freeNodes == NULL) pool -> freeTail = chunk -> nodes + (cnt - 1);
+        for (size_t i = cnt; i > 0; --i) {
+            AvlTree *t = chunk -> nodes + (i - 1);
+            node_traits::construct(nodeAlloc, t);
+            t -> next = pool -> freeNodes;
+            pool -> freeNodes = t;
+        }
+    }
+    // scratch arrays of n node pointers, also drawn from alloc
+    AvlTree **NewPtrs(size_t n) {
+        PtrAlloc ptrAlloc(alloc);
+        return ptr_traits::allocate(ptrAlloc, n);
+    }
+    void DeletePtrs(AvlTree **p, size_t n) {
+        if (p == NULL) return;
+        PtrAlloc ptrAlloc(alloc);
+        ptr_traits::deallocate(ptrAlloc, p, n);
+    }
+    // drop our share of the pool, handing every chunk back if it was the
+    // last one; our nodes must hold no live values
+    void ReleasePool() {
+        if (pool == NULL) return;
+        if (--(pool -> refs) == 0) {
+            NodeAlloc nodeAlloc(alloc);
+            ChunkAlloc chunkAlloc(alloc);
+            PoolAlloc poolAlloc(alloc);
+            while (pool -> chunks) {
+                PoolChunk *chunk = pool -> chunks;
+                pool -> chunks = chunk -> next;
+                for (size_t i = 0; i < chunk -> cnt; ++i)
+                    node_traits::destroy(nodeAlloc, chunk -> nodes + i);
+                node_traits::deallocate(nodeAlloc, chunk -> nodes, chunk -> cnt);
+                chunk_traits::deallocate(chunkAlloc, chunk, 1);
+            }
+            pool_traits::deallocate(poolAlloc, pool, 1);
+        }
+        pool = NULL;
+    }
+    // whether other's nodes can become ours without being rebuilt
+    bool CanAdoptPool(const map &other) const {
+        if (other.pool == NULL || other.pool == pool) return true;
+        return alloc == other.alloc && (pool == NULL || other.pool -> refs == 1);
+    }
+    // make other's nodes ours to keep; CanAdoptPool(other) must hold
+    void AdoptPool(map &other) {
+        if (other.pool == NULL || other.pool == pool) return;
+        if (pool == NULL) {
+            pool = other.pool;
+            other.pool = NULL;
+            return;
+        }
+        // other is the only user of its pool: splice its chunks into ours
+        NodePool *src = other.pool;
+        if (src -> chunks) {
+            PoolChunk *last = src -> chunks;
+            while (last -> next) last = last -> next;
+            last -> next = pool -> chunks;
+            pool -> chunks = src -> chunks;
+        }
+        if (src -> freeNodes) {
+            if (pool -> freeNodes == NULL) pool -> freeTail = src -> freeTail;
+            src -> freeTail -> next = pool -> freeNodes;
+            pool -> freeNodes = src -> freeNodes;
+        }
+        pool -> poolNodes += src -> poolNodes;
+        PoolAlloc poolAlloc(alloc);
+        pool_traits::deallocate(poolAlloc, src, 1);
+        other.pool = NULL;
+    }
+    template<class... Args>
+    AvlTree *NewNode(Args&&... args) {
+        if (pool == NULL || pool -> freeNodes == NULL) {
+            // chunks double with the pool, within [minChunkNodes, maxChunkNodes]
+            size_t cnt = pool ? pool -> poolNodes : 0;
+            if (cnt < minChunkNodes) cnt = minChunkNodes;
+            if (cnt > maxChunkNodes) cnt = maxChunkNodes;
+            GrowPool(cnt);
+        }
+        AvlTree *t = pool -> freeNodes;
+        value_type *v = reinterpret_cast<value_type*>(&(t -> val));
+        alloc_traits::construct(alloc, v, std::forward<Args>(args)...);
+        pool -> freeNodes = t -> next;
+        t -> v = v;
+        t -> l = t -> r = t -> fa = t -> prev = t -> next = NULL;
+        t -> Update();
+        return t;
+    }
+    void DeleteNode(AvlTree *t) {
+        alloc_traits::destroy(alloc, t -> v);
+        t -> v = NULL;
+        if (pool -> freeNodes == NULL) pool -> freeTail = t;
+        t -> next = pool -> freeNodes;
+        pool -> freeNodes = t;
+    }
+    // free the subtree under top bottom-up, climbing back through the
+    // parent links instead of the stack
+    void DestroyTree(AvlTree *top) {
+        AvlTree *t = top;
+        while (t) {
+            if (t -> l) t = t -> l;
+            else if (t -> r) t = t -> r;
+            else {
+                AvlTree *fa = t == top ? NULL : t -> fa;
+                if (fa) {
+                    if (fa -> l == t) fa -> l = NULL;
+                    else fa -> r = NULL;
+                }
+                DeleteNode(t);
+                t = fa;
+            }
+        }
+    }
+    // drop every node at once: values are destroyed only if they need it,
+    // then the chunks go back to the allocator.  A shared pool gets the
+    // nodes back one by one instead
+    void ReleaseTree() {
+        if (!std::is_trivially_destructible<value_type>::value || (pool && pool -> refs > 1))
+            DestroyTree(root);
+        ReleasePool();
+    }
+    AvlTree *CloneNode(const AvlTree *other, AvlTree *fa) {
+        AvlTree *t = NewNode(*(other -> v));
+        t -> sizeT = other -> sizeT;
+        t -> h = other -> h;
+        static_cast<Slot &>(*t) = static_cast<const Slot &>(*other);
+        t -> fa = fa;
+        return t;
+    }
+    // copies the shape, sizes and values of a subtree; prev/next are left NULL.
+    // The walk goes down other's children and back up both trees' parent links
+    AvlTree *CloneTree(const AvlTree *other) {
+        if (other == NULL) return NULL;
+        AvlTree *top = CloneNode(other, NULL), *t = top;
+        const AvlTree *s = other;
+        try {
+            while (true) {
+                if (s -> l && t -> l == NULL) {
+                    t -> l = CloneNode(s -> l, t);
+                    s = s -> l;
+                    t = t -> l;
+                }
+                else if (s -> r && t -> r == NULL) {
+                    t -> r = CloneNode(s -> r, t);
+                    s = s -> r;
+                    t = t -> r;
+                }
+                else if (s == other) break;
+                else {
+                    s = s -> fa;
+                    t = t -> fa;
+                }
+            }
+        }
+        catch (...) {
+            DestroyTree(top);
+            throw;
+        }
+        return top;
+    }
 
-    size_t GetSizeT(const AvlTree *p) {
+    size_t GetSizeT(const AvlTree *p) const {
         if (!p) return 0;
         return p -> sizeT;
     }
-    int GetH(const AvlTree *p) {
+    int GetH(const AvlTree *p) const {
         if (!p) return -1;
         return p -> h;
     }
 
+    // in-order walk of the whole tree under now, through the parent links
     void LDR(AvlTree *now, AvlTree **ldrArr, int &ldrIndex) {
-        if (now -> l) LDR(now -> l, ldrArr, ldrIndex);
-        ldrArr[ldrIndex++] = now;
-        if (now -> r) LDR(now -> r, ldrArr, ldrIndex);
+        AvlTree *top = now;
+        while (now -> l) now = now -> l;
+        while (now) {
+            ldrArr[ldrIndex++] = now;
+            if (now -> r) {
+                now = now -> r;
+                while (now -> l) now = now -> l;
+                continue;
+            }
+            // climb until we come up out of a left subtree
+            while (now != top && now -> fa -> r == now) now = now -> fa;
+            now = now == top ? NULL : now -> fa;
+        }
     }
     void LL(AvlTree *&t) {
         AvlTree *t1 = t -> l;
         t -> l = t1 -> r;
         t1 -> r = t;
+        t1 -> fa = t -> fa;
         t -> Update();
         t1 -> Update();
         t = t1;
@@ -99,6 +433,7 @@ private:
         AvlTree *t1 = t -> r;
         t -> r = t1 -> l;
         t1 -> l = t;
+        t1 -> fa = t -> fa;
         t -> Update();
         t1 -> Update();
         t = t1;
@@ -111,146 +446,673 @@ private:
         LL(t -> r);
         RR(t);
     }
-    AvlTree *Insert(AvlTree *&t, const value_type &v, AvlTree *fa, int lorr) {
-        AvlTree *ret;
-        if (t == NULL) {
-            t = new AvlTree(v);
-            if (lorr == 0) {
-                t -> next = fa;
-                t -> prev = fa -> prev;
-                if (beginA == fa) beginA = t;
-            }
-            else {
-                t -> prev = fa;
-                t -> next = fa -> next;
+    // the link that points at t: its parent's child pointer, or top (the
+    // root of the tree t is in)
+    AvlTree *&LinkOf(AvlTree *t, AvlTree *&top) {
+        if (t -> fa == NULL) return top;
+        return t -> fa -> l == t ? t -> fa -> l : t -> fa -> r;
+    }
+    AvlTree *&LinkOf(AvlTree *t) {
+        return LinkOf(t, root);
+    }
+    // rotate t back into balance if its subtrees differ in height by 2,
+    // else just update it
+    void Balance(AvlTree *&t) {
+        // a balanced child only happens after a removal; one rotation does
+        if (GetH(t -> l) - GetH(t -> r) == 2) {
+            if (GetH(t -> l -> l) >= GetH(t -> l -> r)) LL(t);
+            else LR(t);
+        }
+        else if (GetH(t -> r) - GetH(t -> l) == 2) {
+            if (GetH(t -> r -> r) >= GetH(t -> r -> l)) RR(t);
+            else RL(t);
+        }
+        else t -> Update();
+    }
+    // a node was just hung below p (grown) or cut from below it: rebalance
+    // upwards until a subtree keeps its height; above that only the sizes
+    // change, and the aggregates if the map keeps any
+    void Rebalance(AvlTree *p, bool grown) {
+        bool balancing = true;
+        for (; p; p = p -> fa) {
+            if (!balancing) {
+                if (augmented) p -> Update();
+                else if (grown) ++(p -> sizeT);
+                else --(p -> sizeT);
+                continue;
             }
-            if (t -> prev) t -> prev -> next = t;
-            if (t -> next) t -> next -> prev = t;
-            return t;
+            AvlTree *&t = LinkOf(p);
+            int oldH = t -> h;
+            Balance(t);
+            if (t -> h == oldH) balancing = false;
+            p = t;
         }
-        AvlTree *tmp;
-        if (CmpValue(v, *(t -> v))) {
-            ret = Insert(t -> l, v, t, 0);
-            if (GetH(t -> l) - GetH(t -> r) == 2) {
-                if (CmpValue(v, *(t -> l -> v))) LL(t);
-                else LR(t);
+    }
+    // put the new node t between prev and next in the list
+    void Thread(AvlTree *t, AvlTree *prev, AvlTree *next) {
+        t -> prev = prev;
+        t -> next = next;
+        if (prev) prev -> next = t;
+        else beginA = t;
+        next -> prev = t;
+    }
+    // fold the aggregates again from t up to the root
+    void Refold(AvlTree *t) {
+        for (; t; t = t -> fa) t -> Update();
+    }
+    // take t out of the list
+    void Unthread(AvlTree *t) {
+        if (beginA == t) beginA = t -> next;
+        t -> next -> prev = t -> prev;
+        if (t -> prev) t -> prev -> next = t -> next;
+    }
+    // one descent for key: returns the node holding it, made by make() and
+    // linked in if it is absent; inserted tells which happened
+    template<class K, class Make>
+    AvlTree *Insert(const K &key, bool &inserted, const Make &make) {
+        int lorr = 0;
+        AvlTree **link = &root, *fa = NULL;
+        if (ThreeWay<K>::value) {
+            while (*link) {
+                AvlTree *t = *link;
+                int c = Cmp3(t -> v -> first, key, ThreeWay<K>());
+                if (c == 0) {
+                    inserted = false;
+                    return t;
+                }
+                lorr = c > 0 ? 0 : 1;
+                fa = t;
+                link = lorr == 0 ? &(t -> l) : &(t -> r);
             }
         }
-        else if (CmpValue(*(t -> v), v)) {
-            ret = Insert(t -> r, v, t, 1);
-            if (GetH(t -> r) - GetH(t -> l) == 2) {
-                if (CmpValue(*(t -> r -> v), v)) RR(t);
-                else RL(t);
+        else {
+            // one comparison per node; the only node that can equal key is
+            // the last one not greater than it, checked at the bottom
+            AvlTree *le = NULL;
+            while (*link) {
+                AvlTree *t = *link;
+                lorr = CmpKey(key, t -> v -> first) ? 0 : 1;
+                if (lorr == 1) le = t;
+                fa = t;
+                link = lorr == 0 ? &(t -> l) : &(t -> r);
+            }
+            if (le && !CmpKey(le -> v -> first, key)) {
+                inserted = false;
+                return le;
             }
         }
-        t -> Update();
+        AvlTree *ret = make();
+        inserted = true;
+        *link = ret;
+        ret -> fa = fa;
+        if (fa == NULL) Thread(ret, NULL, &pastTheEnd);
+        else if (lorr == 0) Thread(ret, fa -> prev, fa);
+        else Thread(ret, fa, fa -> next);
+        Rebalance(fa, true);
         return ret;
     }
-    bool Remove(AvlTree *&t, const value_type &x, bool orig) {
-        bool stop = false;
-        int subTree;
-        if (t == NULL) return true;
-        if (CmpValue(x, *(t -> v))) {
-            stop = Remove(t -> l, x, orig);
-            subTree = 0;
-        }
-        else if (CmpValue(*(t -> v), x)) {
-            stop = Remove(t -> r, x, orig);
-            subTree = 1;
-        }
-        else if (t -> l && t -> r) {
-            AvlTree *tmp = t -> r;
-            while (tmp -> l) tmp = tmp -> l;
-            stop = Remove(t -> r, *(tmp -> v), false);
-            tmp -> l = t -> l;
-            tmp -> r = t -> r;
-            tmp -> Update();
-            if (beginA == t) beginA = beginA -> next;
-            if (t -> next) t -> next -> prev = t -> prev;
-            if (t -> prev) t -> prev -> next = t -> next;
-            t -> l = t -> r = NULL;
-            delete t;
-            t = tmp;
-            subTree = 1;
+    // insert key right before hint without a descent if it belongs there;
+    // returns NULL, having changed nothing, if it does not
+    template<class Make>
+    AvlTree *InsertBefore(AvlTree *hint, const Key &key, bool &inserted, const Make &make) {
+        AvlTree *before = hint -> prev;
+        if (hint != &pastTheEnd && !CmpKey(key, hint -> v -> first)) {
+            if (CmpKey(hint -> v -> first, key)) return NULL;
+            inserted = false;
+            return hint;
+        }
+        if (before && !CmpKey(before -> v -> first, key)) {
+            if (CmpKey(key, before -> v -> first)) return NULL;
+            inserted = false;
+            return before;
+        }
+        AvlTree *ret = make();
+        inserted = true;
+        // hint's left slot is free, or before (the rightmost node under it) has a free right slot
+        if (root == NULL) root = ret;
+        else if (hint != &pastTheEnd && hint -> l == NULL) {
+            hint -> l = ret;
+            ret -> fa = hint;
         }
         else {
-            AvlTree *oldNode = t;
-            t = t -> l ? t -> l : t -> r;
-            if (orig) {
-                if (beginA == oldNode) beginA = beginA -> next;
-                if (oldNode -> next) oldNode -> next -> prev = oldNode -> prev;
-                if (oldNode -> prev) oldNode -> prev -> next = oldNode -> next;
-                oldNode -> l = oldNode -> r = NULL;
-                delete oldNode;
+            before -> r = ret;
+            ret -> fa = before;
+        }
+        Thread(ret, before, hint);
+        Rebalance(ret -> fa, true);
+        return ret;
+    }
+    // unlink x from the tree, leaving it in the list.  A node with two
+    // children is replaced by its successor, which is x -> next
+    void Detach(AvlTree *x) {
+        AvlTree *p;  // the lowest node that lost a descendant
+        if (x -> l && x -> r) {
+            AvlTree *s = x -> next;
+            if (s -> fa == x) p = s;
+            else {
+                p = s -> fa;
+                p -> l = s -> r;
+                if (s -> r) s -> r -> fa = p;
+                s -> r = x -> r;
+                s -> r -> fa = s;
             }
-            return false;
+            s -> l = x -> l;
+            s -> l -> fa = s;
+            LinkOf(x) = s;
+            s -> fa = x -> fa;
+            s -> sizeT = x -> sizeT;
+            s -> h = x -> h;
         }
-        t -> Update();
-        if (stop) return true;
-        int bf;
-        switch (subTree) {
-        case 0:
-            bf = GetH(t -> l) - GetH(t -> r) + 1;
-            if (bf == 0) return true;
-            if (bf == 1) return false;
-            if (bf == -1) {
-                int bfr = GetH(t -> r -> l) - GetH(t -> r -> r);
-                switch (bfr) {
-                case 0:
-                    RR(t);
-                    return true;
-                    break;
-                case -1:
-                    RR(t);
-                    return false;
-                    break;
-                default:
-                    RL(t);
-                    return false;
-                }
+        else {
+            AvlTree *c = x -> l ? x -> l : x -> r;
+            p = x -> fa;
+            LinkOf(x) = c;
+            if (c) c -> fa = p;
+        }
+        Rebalance(p, false);
+    }
+    // unlink x from the tree and the list and free it
+    void Remove(AvlTree *x) {
+        Detach(x);
+        Unthread(x);
+        DeleteNode(x);
+    }
+    /**
+     * AVL join of the detached trees l and r around the single node k,
+     * where every key in l < k's < every key in r: k goes down the spine
+     * of the taller tree to a subtree about as high as the shorter one,
+     * and the path back up is rebalanced.  O(|height(l) - height(r)| + 1)
+     * rotations and updates; returns the root, whose fa is NULL.
+     */
+    AvlTree *Join(AvlTree *l, AvlTree *k, AvlTree *r) {
+        int hl = GetH(l), hr = GetH(r);
+        k -> fa = NULL;
+        if (hl - hr <= 1 && hr - hl <= 1) {
+            k -> l = l;
+            k -> r = r;
+            k -> Update();
+            return k;
+        }
+        AvlTree *top, *p = NULL, *c;
+        if (hl > hr) {
+            top = c = l;
+            while (GetH(c) > hr + 1) {
+                p = c;
+                c = c -> r;
             }
-            break;
-        case 1:
-            bf = GetH(t -> l) - GetH(t -> r) - 1;
-            if (bf == 0) return true;
-            if (bf == -1) return false;
-            if (bf == 1) {
-                int bfl = GetH(t -> l -> l) - GetH(t -> l -> r);
-                switch (bfl) {
-                case 0:
-                    LL(t);
-                    return true;
-                    break;
-                case 1:
-                    LL(t);
-                    return false;
-                    break;
-                default:
-                    LR(t);
-                    return false;
-                }
+            k -> l = c;
+            k -> r = r;
+            p -> r = k;
+        }
+        else {
+            top = c = r;
+            while (GetH(c) > hl + 1) {
+                p = c;
+                c = c -> l;
             }
-            break;
+            k -> l = l;
+            k -> r = c;
+            p -> l = k;
+        }
+        k -> fa = p;
+        k -> Update();
+        Retrace(p, top);
+        return top;
+    }
+    // rebalance every node from p up to top, the root of its tree
+    void Retrace(AvlTree *p, AvlTree *&top) {
+        while (p) {
+            AvlTree *&t = LinkOf(p, top);
+            Balance(t);
+            p = t -> fa;
+        }
+    }
+    // Join without a middle node: the smallest node of r is taken out for it
+    AvlTree *Join(AvlTree *l, AvlTree *r) {
+        if (l == NULL) return r;
+        if (r == NULL) return l;
+        AvlTree *k = r;
+        while (k -> l) k = k -> l;
+        AvlTree *p = k -> fa;
+        if (k -> r) k -> r -> fa = p;
+        if (p) {
+            p -> l = k -> r;
+            Retrace(p, r);
+        }
+        else r = k -> r;
+        return Join(l, k, r);
+    }
+    /**
+     * Split the detached tree t into the nodes with keys less than key (l),
+     * the one equal to it if any (mid) and those greater (r), all detached.
+     * The descent is replayed upwards through the parent links, joining
+     * each node and its other subtree onto the side it belongs to; the
+     * joins telescope to O(log n).
+     */
+    void SplitTree(AvlTree *t, const Key &key, AvlTree *&l, AvlTree *&mid, AvlTree *&r) {
+        AvlTree *last = NULL;
+        bool right = false;  // whether the descent left last to the right
+        while (t) {
+            int c = Cmp3(t -> v -> first, key, ThreeWay<Key>());
+            if (c == 0) break;
+            last = t;
+            right = c < 0;
+            t = right ? t -> r : t -> l;
+        }
+        l = r = mid = NULL;
+        if (t) {
+            mid = t;
+            l = t -> l;
+            r = t -> r;
+            if (l) l -> fa = NULL;
+            if (r) r -> fa = NULL;
+        }
+        // the side each node goes to is the side the descent left it by
+        for (t = last; t; ) {
+            AvlTree *up = t -> fa;
+            bool upRight = up && up -> r == t;
+            if (right) {
+                if (t -> l) t -> l -> fa = NULL;
+                l = Join(t -> l, t, l);
+            }
+            else {
+                if (t -> r) t -> r -> fa = NULL;
+                r = Join(r, t, t -> r);
+            }
+            t = up;
+            right = upRight;
+        }
+    }
+    // make other's nodes draw on our pool, rebuilding them in it if the
+    // pools cannot merge; other must hand its tree over right after
+    void AdoptNodes(map &other) {
+        if (CanAdoptPool(other)) {
+            AdoptPool(other);
+            return;
         }
+        map tmp(alloc);
+        tmp.CmpKey = CmpKey;
+        tmp.CopyFrom(other);
+        other.clear();
+        AdoptPool(tmp);
+        other.StealTree(tmp);
+    }
+    // append other's nodes to ours; their keys must all be on one side of
+    // ours and AdoptNodes(other) must have been done.  other is left empty
+    void JoinFrom(map &other) {
+        if (other.root == NULL) return;
+        if (root == NULL) {
+            StealTree(other);
+            return;
+        }
+        bool below = CmpKey(pastTheEnd.prev -> v -> first, other.beginA -> v -> first);
+        map &lo = below ? *this : other, &hi = below ? other : *this;
+        AvlTree *loFirst = lo.beginA, *loLast = lo.pastTheEnd.prev;
+        AvlTree *hiFirst = hi.beginA, *hiLast = hi.pastTheEnd.prev;
+        // the smallest key of the upper tree is the middle of the join
+        hi.Detach(hiFirst);
+        root = Join(lo.root, hiFirst, hi.root);
+        loLast -> next = hiFirst;
+        hiFirst -> prev = loLast;
+        beginA = loFirst;
+        pastTheEnd.prev = hiLast;
+        sizeM += other.sizeM;
+        LinkEnd();
+        other.Disown();
+    }
+    /**
+     * Divide and conquer over t1: t2 is split by t1's key and each half is
+     * merged with the subtree of t1 on its side, then the results are
+     * joined around t1.  O(m log(n / m + 1)) for trees of sizes m <= n.
+     * Both trees are consumed and the result returned detached; equal
+     * keys keep t1's node, the node from t2 is freed.
+     */
+    AvlTree *Union(AvlTree *t1, AvlTree *t2) {
+        if (t2 == NULL) {
+            if (t1) t1 -> fa = NULL;
+            return t1;
+        }
+        if (t1 == NULL) return t2;
+        AvlTree *l2, *mid, *r2, *l1 = t1 -> l, *r1 = t1 -> r;
+        SplitTree(t2, t1 -> v -> first, l2, mid, r2);
+        if (mid) DeleteNode(mid);
+        AvlTree *l = Union(l1, l2), *r = Union(r1, r2);
+        return Join(l, t1, r);
+    }
+    // as Union, keeping only t1's nodes whose keys are in t2 too
+    AvlTree *Intersect(AvlTree *t1, AvlTree *t2) {
+        if (t1 == NULL || t2 == NULL) {
+            DestroyTree(t1);
+            DestroyTree(t2);
+            return NULL;
+        }
+        AvlTree *l2, *mid, *r2, *l1 = t1 -> l, *r1 = t1 -> r;
+        SplitTree(t2, t1 -> v -> first, l2, mid, r2);
+        AvlTree *l = Intersect(l1, l2), *r = Intersect(r1, r2);
+        if (mid == NULL) {
+            DeleteNode(t1);
+            return Join(l, r);
+        }
+        DeleteNode(mid);
+        return Join(l, t1, r);
+    }
+    // as Union, keeping only t1's nodes whose keys are not in t2; those
+    // dropped are taken out of the list and counted off sizeM
+    AvlTree *Subtract(AvlTree *t1, AvlTree *t2) {
+        if (t1 == NULL) {
+            DestroyTree(t2);
+            return NULL;
+        }
+        if (t2 == NULL) {
+            t1 -> fa = NULL;
+            return t1;
+        }
+        AvlTree *l2, *mid, *r2, *l1 = t1 -> l, *r1 = t1 -> r;
+        SplitTree(t2, t1 -> v -> first, l2, mid, r2);
+        AvlTree *l = Subtract(l1, l2), *r = Subtract(r1, r2);
+        if (mid == NULL) return Join(l, t1, r);
+        DeleteNode(mid);
+        Unthread(t1);
+        DeleteNode(t1);
+        --sizeM;
+        return Join(l, r);
+    }
+    // in-order neighbours of t found through the tree, NULL past either end
+    AvlTree *TreePrev(AvlTree *t) {
+        if (t -> l) {
+            for (t = t -> l; t -> r; t = t -> r);
+            return t;
+        }
+        while (t -> fa && t -> fa -> l == t) t = t -> fa;
+        return t -> fa;
+    }
+    AvlTree *TreeNext(AvlTree *t) {
+        if (t -> r) {
+            for (t = t -> r; t -> l; t = t -> l);
+            return t;
+        }
+        while (t -> fa && t -> fa -> r == t) t = t -> fa;
+        return t -> fa;
     }
     AvlTree* GetKth(AvlTree *t, int k) {
-        if (k <= GetSizeT(t -> l)) return GetKth(t -> l, k);
-        k -= GetSizeT(t -> l);
-        if (k == 1) return t;
-        --k;
-        return GetKth(t -> r, k);
+        while (true) {
+            if (k <= GetSizeT(t -> l)) {
+                t = t -> l;
+                continue;
+            }
+            k -= GetSizeT(t -> l);
+            if (k == 1) return t;
+            --k;
+            t = t -> r;
+        }
     }
     const AvlTree* GetKth(AvlTree *t, int k) const {
-        if (k <= GetSizeT(t -> l)) return GetKth(t -> l, k);
-        k -= GetSizeT(t -> l);
-        if (k == 1) return t;
-        --k;
-        return GetKth(t -> r, k);
+        return const_cast<map*>(this) -> GetKth(t, k);
+    }
+    static void Prefetch(const void *p) {
+#if defined(__GNUC__)
+        __builtin_prefetch(p);
+#endif
+    }
+    static const int batchLanes = 16;
+    // whether Compare takes probes other than Key as they are
+    template<class C, class = void>
+    struct Transparent : std::false_type {};
+    template<class C>
+    struct Transparent<C, typename std::conditional<true, void, typename C::is_transparent>::type> : std::true_type {};
+    // the probes of one FindGroup: read through the iterators if Compare
+    // takes them as they are, otherwise converted to Key once each, on
+    // loading, rather than at every level of the descent
+    template<class ForwardIt, class K = typename std::decay<decltype(*std::declval<ForwardIt>())>::type,
+             bool convert = !std::is_same<K, Key>::value && !Transparent<Compare>::value>
+    struct GroupKeys {
+        typedef K type;
+        ForwardIt it[batchLanes];
+        void Load(int i, ForwardIt pos) {
+            it[i] = pos;
+        }
+        auto operator[](int i) const -> decltype(*it[i]) {
+            return *it[i];
+        }
+    };
+    template<class ForwardIt, class K>
+    struct GroupKeys<ForwardIt, K, true> {
+        typedef Key type;
+        typename std::aligned_storage<sizeof(Key), alignof(Key)>::type buf[batchLanes];
+        int n;
+        GroupKeys(): n(0) {}
+        GroupKeys(const GroupKeys &) = delete;
+        ~GroupKeys() {
+            for (int i = 0; i < n; ++i) (*this)[i].~Key();
+        }
+        void Load(int i, ForwardIt pos) {
+            ::new (static_cast<void*>(buf + i)) Key(*pos);
+            n = i + 1;
+        }
+        const Key &operator[](int i) const {
+            return *reinterpret_cast<const Key*>(buf + i);
+        }
+    };
+    /**
+     * Look up to batchLanes keys from first, advancing it, in descents
+     * run side by side a level at a time: each prefetches the node it
+     * moves to and only reads it a round later, so the cache misses of
+     * all of them overlap.  found[i] gets the node holding the i-th key,
+     * or NULL; returns how many keys were taken.
+     */
+    template<class ForwardIt>
+    int FindGroup(ForwardIt &first, ForwardIt last, AvlTree *found[]) const {
+        typedef GroupKeys<ForwardIt> Keys;
+        typedef typename Keys::type K;
+        Keys key;
+        AvlTree *t[batchLanes];
+        int n = 0;
+        for (; n < batchLanes && first != last; ++n, ++first) {
+            key.Load(n, first);
+            t[n] = root;
+            found[n] = NULL;
+        }
+        for (bool live = true; live; ) {
+            live = false;
+            for (int i = 0; i < n; ++i) {
+                if (!t[i]) continue;
+                if (ThreeWay<K>::value) {
+                    int c = Cmp3(t[i] -> v -> first, key[i], ThreeWay<K>());
+                    if (c == 0) {
+                        found[i] = t[i];
+                        t[i] = NULL;
+                        continue;
+                    }
+                    t[i] = c > 0 ? t[i] -> l : t[i] -> r;
+                }
+                else if (CmpKey(key[i], t[i] -> v -> first)) t[i] = t[i] -> l;
+                else {
+                    // as in FindNode: the last node not greater than the key
+                    found[i] = t[i];
+                    t[i] = t[i] -> r;
+                }
+                if (t[i]) {
+                    Prefetch(t[i]);
+                    Prefetch(&(t[i] -> val));
+                    live = true;
+                }
+            }
+        }
+        if (!ThreeWay<K>::value) {
+            for (int i = 0; i < n; ++i) {
+                if (found[i] && CmpKey(found[i] -> v -> first, key[i])) found[i] = NULL;
+            }
+        }
+        return n;
+    }
+    // the node holding key, or NULL
+    template<class K>
+    AvlTree *FindNode(const K &key) const {
+        return FindNode(key, ThreeWay<K>());
+    }
+    template<class K>
+    AvlTree *FindNode(const K &key, std::true_type) const {
+        AvlTree *t = root;
+        while (t) {
+            int c = Cmp3(t -> v -> first, key, std::true_type());
+            if (c == 0) return t;
+            t = c > 0 ? t -> l : t -> r;
+        }
+        return NULL;
+    }
+    // one comparison per node down to the last node not greater than key,
+    // then one to see if it equals key
+    template<class K>
+    AvlTree *FindNode(const K &key, std::false_type) const {
+        AvlTree *t = root, *le = NULL;
+        while (t) {
+            if (CmpKey(key, t -> v -> first)) t = t -> l;
+            else {
+                le = t;
+                t = t -> r;
+            }
+        }
+        if (le && !CmpKey(le -> v -> first, key)) return le;
+        return NULL;
+    }
+    // the first node whose key is not less than key (greater than key if
+    // upper), or the sentinel; less counts the nodes before it
+    AvlTree *Bound(const Key &key, bool upper, size_t &less) const {
+        AvlTree *t = root, *ret = const_cast<AvlTree*>(&pastTheEnd);
+        less = 0;
+        while (t) {
+            if (upper ? CmpKey(key, t -> v -> first) : !CmpKey(t -> v -> first, key)) {
+                ret = t;
+                t = t -> l;
+            }
+            else {
+                less += GetSizeT(t -> l) + 1;
+                t = t -> r;
+            }
+        }
+        return ret;
     }
 
     size_t sizeM;
     AvlTree pastTheEnd, *root, *beginA;
 
+    // deep copy other's tree into this (empty) map and thread the copy
+    void CopyFrom(const map &other) {
+        if (other.root == NULL) return;
+        if (pool == NULL) GrowPool(other.sizeM);
+        AvlTree **nodes = NewPtrs(other.sizeM);
+        try {
+            root = CloneTree(other.root);
+        }
+        catch (...) {
+            DeletePtrs(nodes, other.sizeM);
+            throw;
+        }
+        sizeM = other.sizeM;
+        int ldrIndex = 0;
+        LDR(root, nodes, ldrIndex);
+        ThreadNodes(nodes, sizeM);
+        DeletePtrs(nodes, sizeM);
+    }
+    // chain nodes[0, n), in key order, into the prev/next list; root must be set
+    void ThreadNodes(AvlTree **nodes, size_t n) {
+        for (size_t i = 0; i + 1 < n; ++i) {
+            nodes[i] -> next = nodes[i + 1];
+            nodes[i + 1] -> prev = nodes[i];
+        }
+        nodes[0] -> prev = NULL;
+        beginA = nodes[0];
+        pastTheEnd.prev = nodes[n - 1];
+        LinkEnd();
+    }
+    // perfectly balanced tree over nodes[lo, hi), which are in key order
+    AvlTree *BuildTree(AvlTree **nodes, size_t lo, size_t hi) {
+        if (lo >= hi) return NULL;
+        size_t mid = lo + (hi - lo) / 2;
+        AvlTree *t = nodes[mid];
+        t -> l = BuildTree(nodes, lo, mid);
+        t -> r = BuildTree(nodes, mid + 1, hi);
+        t -> Update();
+        return t;
+    }
+    // new nodes for [first, last) in input order, chained through next
+    template<class InputIt>
+    AvlTree *MakeNodes(InputIt first, InputIt last, size_t &n) {
+        AvlTree *head = NULL, *tail = NULL;
+        n = 0;
+        try {
+            for (; first != last; ++first) {
+                AvlTree *t = NewNode(value_type((*first).first, (*first).second));
+                if (tail) tail -> next = t;
+                else head = t;
+                tail = t;
+                ++n;
+            }
+        }
+        catch (...) {
+            DeleteChain(head);
+            throw;
+        }
+        return head;
+    }
+    void DeleteChain(AvlTree *t) {
+        while (t) {
+            AvlTree *tmp = t -> next;
+            DeleteNode(t);
+            t = tmp;
+        }
+    }
+    // put nodes[0, n) in key order (sorting only if needed) and delete all
+    // but the first of equal keys; returns how many are left
+    size_t SortNodes(AvlTree **nodes, size_t n) {
+        bool sorted = true;
+        for (size_t i = 1; i < n && sorted; ++i)
+            sorted = CmpValue(*(nodes[i - 1] -> v), *(nodes[i] -> v));
+        if (!sorted) {
+            std::stable_sort(nodes, nodes + n, [this](const AvlTree *a, const AvlTree *b) {
+                return CmpValue(*(a -> v), *(b -> v));
+            });
+        }
+        size_t m = 0;
+        for (size_t i = 0; i < n; ++i) {
+            if (m > 0 && !CmpValue(*(nodes[m - 1] -> v), *(nodes[i] -> v))) DeleteNode(nodes[i]);
+            else nodes[m++] = nodes[i];
+        }
+        return m;
+    }
+    // take other's tree, leaving it empty; allocators must be compatible
+    void StealFrom(map &other) {
+        pool = other.pool;
+        other.pool = NULL;
+        StealTree(other);
+    }
+    // take other's tree but not its pool; our pool must hold its nodes
+    void StealTree(map &other) {
+        root = other.root;
+        sizeM = other.sizeM;
+        beginA = other.beginA;
+        pastTheEnd.prev = other.pastTheEnd.prev;
+        LinkEnd();
+        other.Disown();
+    }
+    // forget the tree, whose nodes have been taken elsewhere
+    void Disown() {
+        root = NULL;
+        sizeM = 0;
+        pastTheEnd.prev = NULL;
+        LinkEnd();
+    }
+    // point the last node and the sentinel at each other
+    void LinkEnd() {
+        pastTheEnd.next = NULL;
+        if (root == NULL) {
+            beginA = &pastTheEnd;
+            pastTheEnd.prev = NULL;
+            return;
+        }
+        pastTheEnd.prev -> next = &pastTheEnd;
+    }
+
 public:
 	class const_iterator;
 	class iterator {
@@ -262,6 +1124,7 @@ public:
     public:
 		iterator(): ctn(NULL), p(NULL) {}
 		iterator(const iterator &other): ctn(other.ctn), p(other.p) {}
+		iterator &operator=(const iterator &other) = default;
 		iterator operator++(int) {
             iterator tmp(*this);
             if (p -> next == NULL) throw invalid_iterator();
@@ -314,6 +1177,7 @@ public:
         const_iterator(): ctn(NULL), p(NULL) {}
         const_iterator(const const_iterator &other): ctn(other.ctn), p(other.p) {}
         const_iterator(const iterator &other): ctn(other.ctn), p(other.p) {}
+        const_iterator &operator=(const const_iterator &other) = default;
 
         const_iterator operator++(int) {
             const_iterator tmp(*this);
@@ -358,100 +1222,126 @@ public:
 		}
 	};
 
-	map(): root(NULL), beginA(&pastTheEnd), sizeM(0) {}
-	map(const map &other): sizeM(other.sizeM) {
-        if (other.root) {
-            root = new AvlTree(*(other.root));
-            AvlTree **nodes = new AvlTree*[sizeM];
-            int ldrIndex = 0;
-            LDR(root, nodes, ldrIndex);
-            for (int i = 0; i < sizeM - 1; ++i) {
-                nodes[i] -> next = nodes[i + 1];
-                nodes[i + 1] -> prev = nodes[i];
-            }
-            nodes[0] -> prev = NULL;
-            nodes[sizeM - 1] -> next = &pastTheEnd;
-            beginA = nodes[0];
-            pastTheEnd.next = NULL;
-            pastTheEnd.prev = nodes[sizeM - 1];
-            delete [] nodes;
+	map(): pool(NULL), root(NULL), beginA(&pastTheEnd), sizeM(0) {}
+	explicit map(const Allocator &a):
+	    alloc(a), pool(NULL), root(NULL), beginA(&pastTheEnd), sizeM(0) {}
+	// bulk load; of equal keys the first one wins, as with repeated insert
+	template<class InputIt>
+	map(InputIt first, InputIt last, const Allocator &a = Allocator()):
+	    alloc(a), pool(NULL), root(NULL), beginA(&pastTheEnd), sizeM(0) {
+        try {
+            insert_sorted(first, last);
         }
-        else {
-            root = NULL;
-            pastTheEnd.prev = pastTheEnd.next = NULL;
-            beginA = &pastTheEnd;
+        catch (...) {
+            ReleaseTree();
+            throw;
         }
 	}
-
+	map(const map &other):
+	    CmpKey(other.CmpKey),
+	    alloc(alloc_traits::select_on_container_copy_construction(other.alloc)),
+	    pool(NULL), root(NULL), beginA(&pastTheEnd), sizeM(0) {
+        try {
+            CopyFrom(other);
+        }
+        catch (...) {
+            ReleaseTree();
+            throw;
+        }
+	}
+	map(map &&other):
+	    CmpKey(other.CmpKey), alloc(std::move(other.alloc)),
+	    pool(NULL), root(NULL), beginA(&pastTheEnd), sizeM(0) {
+        StealFrom(other);
+	}
 	map & operator=(const map &other) {
         if (&other == this) return *this;
-        sizeM = other.sizeM;
-        if (root) delete root;
-        if (other.root) {
-            root = new AvlTree(*(other.root));
-            AvlTree **nodes = new AvlTree*[sizeM];
-            int ldrIndex = 0;
-            LDR(root, nodes, ldrIndex);
-            for (int i = 0; i < sizeM - 1; ++i) {
-                nodes[i] -> next = nodes[i + 1];
-                nodes[i + 1] -> prev = nodes[i];
-            }
-            nodes[0] -> prev = NULL;
-            nodes[sizeM - 1] -> next = &pastTheEnd;
-            beginA = nodes[0];
-            pastTheEnd.next = NULL;
-            pastTheEnd.prev = nodes[sizeM - 1];
-            delete [] nodes;
+        clear();
+        if (alloc_traits::propagate_on_container_copy_assignment::value)
+            alloc = other.alloc;
+        CmpKey = other.CmpKey;
+        CopyFrom(other);
+        return *this;
+	}
+	map & operator=(map &&other) {
+        if (&other == this) return *this;
+        clear();
+        CmpKey = other.CmpKey;
+        if (alloc_traits::propagate_on_container_move_assignment::value) {
+            alloc = std::move(other.alloc);
+            StealFrom(other);
         }
+        else if (alloc == other.alloc) StealFrom(other);
         else {
-            root = NULL;
-            pastTheEnd.prev = pastTheEnd.next = NULL;
-            beginA = &pastTheEnd;
+            // nodes from a foreign allocator must be rebuilt with ours
+            CopyFrom(other);
+            other.clear();
         }
         return *this;
 	}
 	~map() {
-        if (root) delete root;
+        ReleaseTree();
     }
+	void swap(map &other) {
+        if (alloc_traits::propagate_on_container_swap::value)
+            std::swap(alloc, other.alloc);
+        std::swap(CmpKey, other.CmpKey);
+        std::swap(pool, other.pool);
+        std::swap(root, other.root);
+        std::swap(sizeM, other.sizeM);
+        std::swap(beginA, other.beginA);
+        std::swap(pastTheEnd.prev, other.pastTheEnd.prev);
+        LinkEnd();
+        other.LinkEnd();
+	}
+	allocator_type get_allocator() const {
+        return alloc;
+	}
 
 	T & at(const Key &key) {
-        AvlTree *t = root;
-        while (t && !EqualKey(t -> v -> first, key)) {
-            if (CmpKey(key, t -> v -> first)) t = t -> l;
-            else t = t -> r;
-        }
+        AvlTree *t = FindNode(key);
         if (!t) throw index_out_of_bound();
         else return t -> v -> second;
 	}
 	const T & at(const Key &key) const {
-        const AvlTree *t = root;
-        while (t && !EqualKey(t -> v -> first, key)) {
-            if (CmpKey(key, t -> v -> first)) t = t -> l;
-            else t = t -> r;
-        }
+        const AvlTree *t = FindNode(key);
         if (!t) throw index_out_of_bound();
         else return t -> v -> second;
 	}
 	T & operator[](const Key &key) {
-        AvlTree *t = root;
-        while (t && !EqualKey(t -> v -> first, key)) {
-            if (CmpKey(key, t -> v -> first)) t = t -> l;
-            else t = t -> r;
-        }
-        if (t) return t -> v -> second;
-        iterator newIt = insert(pair<Key, T>(key, T())).first;
-        t = newIt.p;
-        return t -> v -> second;
+        return try_emplace(key).first -> second;
 	}
 	const T & operator[](const Key &key) const {
-        const AvlTree *t = root;
-        while (t && !EqualKey(t -> v -> first, key)) {
-            if (CmpKey(key, t -> v -> first)) t = t -> l;
-            else t = t -> r;
-        }
+        return at(key);
+	}
+	// lookups by anything Compare can order against Key, such as a
+	// const char * into a map keyed by std::string under std::less<>;
+	// only a missing key given to operator[] is converted to a Key
+	template<class K, class C = Compare, class = typename C::is_transparent>
+	T & at(const K &key) {
+        AvlTree *t = FindNode(key);
+        if (!t) throw index_out_of_bound();
+        else return t -> v -> second;
+	}
+	template<class K, class C = Compare, class = typename C::is_transparent>
+	const T & at(const K &key) const {
+        const AvlTree *t = FindNode(key);
         if (!t) throw index_out_of_bound();
         else return t -> v -> second;
 	}
+	template<class K, class C = Compare, class = typename C::is_transparent>
+	T & operator[](const K &key) {
+        bool inserted;
+        AvlTree *t = Insert(key, inserted, [&]() {
+            return NewNode(std::piecewise_construct, std::forward_as_tuple(key), std::forward_as_tuple());
+        });
+        if (inserted) ++sizeM;
+        return t -> v -> second;
+	}
+	template<class K, class C = Compare, class = typename C::is_transparent>
+	const T & operator[](const K &key) const {
+        return at(key);
+	}
 
 	iterator begin() {
         return iterator(this, beginA);
@@ -472,63 +1362,398 @@ public:
         return sizeM;
 	}
 	void clear() {
-        if (root) delete root;
+        ReleaseTree();
         root = NULL;
         sizeM = 0;
         pastTheEnd.prev = pastTheEnd.next = NULL;
         beginA = &pastTheEnd;
 	}
 	pair<iterator, bool> insert(const value_type &value) {
-        if (sizeM == 0) {
-            ++sizeM;
-            root = new AvlTree(value);
-            beginA = root;
-            root -> next = &pastTheEnd;
-            pastTheEnd.prev = root;
-            return pair<iterator, bool>(iterator(this, root), true);
-        }
-        iterator fd = find(value.first);
-        if (fd.p != &pastTheEnd) return pair<iterator, bool>(fd, false);
-        ++sizeM;
-        AvlTree *newE = Insert(root, value, NULL, 0);
-        return pair<iterator, bool>(iterator(this, newE), true);
+        bool inserted;
+        AvlTree *t = Insert(value.first, inserted, [&]() {
+            return NewNode(value);
+        });
+        if (inserted) ++sizeM;
+        return pair<iterator, bool>(iterator(this, t), inserted);
+	}
+	// the value is built first and dropped again if its key is taken
+	template<class... Args>
+	pair<iterator, bool> emplace(Args&&... args) {
+        AvlTree *node = NewNode(std::forward<Args>(args)...), *t;
+        bool inserted;
+        try {
+            t = Insert(node -> v -> first, inserted, [node]() {
+                return node;
+            });
+        }
+        catch (...) {
+            DeleteNode(node);
+            throw;
+        }
+        if (inserted) ++sizeM;
+        else DeleteNode(node);
+        return pair<iterator, bool>(iterator(this, t), inserted);
+	}
+	// T is built from args only if key is absent
+	template<class... Args>
+	pair<iterator, bool> try_emplace(const Key &key, Args&&... args) {
+        bool inserted;
+        AvlTree *t = Insert(key, inserted, [&]() {
+            return NewNode(std::piecewise_construct, std::forward_as_tuple(key),
+                           std::forward_as_tuple(std::forward<Args>(args)...));
+        });
+        if (inserted) ++sizeM;
+        return pair<iterator, bool>(iterator(this, t), inserted);
+	}
+	/**
+	 * Insert value right before hint if its key belongs there (e.g. end()
+	 * when keys arrive in ascending order): no key comparisons beyond the
+	 * two neighbours, and the rebalancing climbs from the new leaf via
+	 * parent links.  A wrong hint falls back to a normal descent.
+	 */
+	iterator insert(const_iterator hint, const value_type &value) {
+        if (hint.ctn != this) throw invalid_iterator();
+        bool inserted;
+        auto make = [&]() {
+            return NewNode(value);
+        };
+        AvlTree *t = InsertBefore(const_cast<AvlTree*>(hint.p), value.first, inserted, make);
+        if (t == NULL) t = Insert(value.first, inserted, make);
+        if (inserted) ++sizeM;
+        return iterator(this, t);
+	}
+	template<class... Args>
+	iterator emplace_hint(const_iterator hint, Args&&... args) {
+        if (hint.ctn != this) throw invalid_iterator();
+        AvlTree *node = NewNode(std::forward<Args>(args)...), *t;
+        bool inserted;
+        auto make = [node]() {
+            return node;
+        };
+        try {
+            t = InsertBefore(const_cast<AvlTree*>(hint.p), node -> v -> first, inserted, make);
+            if (t == NULL) t = Insert(node -> v -> first, inserted, make);
+        }
+        catch (...) {
+            DeleteNode(node);
+            throw;
+        }
+        if (inserted) ++sizeM;
+        else DeleteNode(node);
+        return iterator(this, t);
+	}
+	template<class M>
+	pair<iterator, bool> insert_or_assign(const Key &key, M &&obj) {
+        bool inserted;
+        AvlTree *t = Insert(key, inserted, [&]() {
+            return NewNode(key, std::forward<M>(obj));
+        });
+        if (inserted) ++sizeM;
+        else {
+            t -> v -> second = std::forward<M>(obj);
+            if (augmented) Refold(t);
+        }
+        return pair<iterator, bool>(iterator(this, t), inserted);
+	}
+	/**
+	 * Insert every pair in [first, last) and rebuild a perfectly balanced
+	 * tree in O(size() + n) when the range is sorted by key; otherwise it
+	 * is sorted first.  Keys already in the map keep their values, and of
+	 * equal keys in the range the first one wins, as with insert.
+	 */
+	template<class InputIt>
+	void insert_sorted(InputIt first, InputIt last) {
+        size_t n;
+        AvlTree *chain = MakeNodes(first, last, n);
+        if (n == 0) return;
+        const size_t nodesCap = n, mergedCap = sizeM + n;
+        AvlTree **nodes = NULL, **merged = NULL;
+        try {
+            nodes = NewPtrs(nodesCap);
+            merged = NewPtrs(mergedCap);
+        }
+        catch (...) {
+            DeletePtrs(nodes, nodesCap);
+            DeleteChain(chain);
+            throw;
+        }
+        for (size_t i = 0; i < n; ++i, chain = chain -> next)
+            nodes[i] = chain;
+        n = SortNodes(nodes, n);
+        // merge with the nodes already threaded in key order
+        size_t cnt = 0, j = 0;
+        AvlTree *t = beginA;
+        while (t != &pastTheEnd || j < n) {
+            if (j == n || (t != &pastTheEnd && CmpValue(*(t -> v), *(nodes[j] -> v)))) {
+                merged[cnt++] = t;
+                t = t -> next;
+            }
+            else if (t == &pastTheEnd || CmpValue(*(nodes[j] -> v), *(t -> v)))
+                merged[cnt++] = nodes[j++];
+            else DeleteNode(nodes[j++]);
+        }
+        root = BuildTree(merged, 0, cnt);
+        root -> fa = NULL;
+        sizeM = cnt;
+        ThreadNodes(merged, cnt);
+        DeletePtrs(nodes, nodesCap);
+        DeletePtrs(merged, mergedCap);
+	}
+	/**
+	 * Move the keys not less than key into a new map, in O(log n): the
+	 * tree is split along the path to key, and both halves go on drawing
+	 * nodes from the same pool, which lives until the last of them is
+	 * destroyed.
+	 */
+	map split(const Key &key) {
+        map upper(alloc);
+        upper.CmpKey = CmpKey;
+        size_t less;
+        AvlTree *first = Bound(key, false, less);
+        if (first == &pastTheEnd) return upper;
+        AvlTree *l, *mid, *r;
+        SplitTree(root, key, l, mid, r);
+        if (mid) r = Join(NULL, mid, r);
+        upper.pool = pool;
+        ++(pool -> refs);
+        upper.root = r;
+        upper.sizeM = sizeM - less;
+        upper.beginA = first;
+        upper.pastTheEnd.prev = pastTheEnd.prev;
+        upper.LinkEnd();
+        root = l;
+        sizeM = less;
+        pastTheEnd.prev = first -> prev;
+        first -> prev = NULL;
+        LinkEnd();
+        return upper;
+	}
+	/**
+	 * Take every element of other, whose keys must all be less than ours
+	 * or all greater, leaving it empty; throws runtime_error, changing
+	 * nothing, if the key ranges overlap.  O(log n) when the two maps
+	 * share a pool (e.g. one was split from the other), or other's is its
+	 * own and our allocators compare equal; otherwise other's elements are
+	 * copied into our pool first.
+	 */
+	void join(map &other) {
+        if (&other == this || other.root == NULL) return;
+        if (root != NULL && !CmpKey(pastTheEnd.prev -> v -> first, other.beginA -> v -> first)
+            && !CmpKey(other.pastTheEnd.prev -> v -> first, beginA -> v -> first))
+            throw runtime_error();
+        AdoptNodes(other);
+        JoinFrom(other);
+	}
+	/**
+	 * Set algebra by divide and conquer over the two trees with split and
+	 * join, in O(m log(n / m + 1)) for sizes m <= n rather than m inserts
+	 * or erases.  other is consumed and left empty, its nodes reused or
+	 * freed; where both have a key, ours is kept with its value.
+	 * merge_union threads the nodes taken from other into our list in
+	 * O(log n) each; merge_intersection rethreads what is left.
+	 */
+	void merge_union(map &other) {
+        if (&other == this || other.root == NULL) return;
+        const size_t takenCap = other.sizeM;
+        AvlTree **taken = NewPtrs(takenCap);
+        try {
+            AdoptNodes(other);
+        }
+        catch (...) {
+            DeletePtrs(taken, takenCap);
+            throw;
+        }
+        size_t m = 0;
+        for (AvlTree *t = other.beginA; t != &other.pastTheEnd; t = t -> next)
+            taken[m++] = t;
+        root = Union(root, other.root);
+        other.Disown();
+        sizeM = root -> sizeT;
+        for (size_t i = 0; i < m; ++i) {
+            if (taken[i] -> v == NULL) continue;
+            AvlTree *next = TreeNext(taken[i]);
+            Thread(taken[i], TreePrev(taken[i]), next ? next : &pastTheEnd);
+        }
+        LinkEnd();
+        DeletePtrs(taken, takenCap);
+	}
+	void merge_intersection(map &other) {
+        if (&other == this) return;
+        const size_t nodesCap = gmin(sizeM, other.sizeM) + 1;
+        AvlTree **nodes = NewPtrs(nodesCap);
+        try {
+            AdoptNodes(other);
+        }
+        catch (...) {
+            DeletePtrs(nodes, nodesCap);
+            throw;
+        }
+        root = Intersect(root, other.root);
+        other.Disown();
+        sizeM = GetSizeT(root);
+        if (root == NULL) {
+            LinkEnd();
+            DeletePtrs(nodes, nodesCap);
+            return;
+        }
+        int ldrIndex = 0;
+        LDR(root, nodes, ldrIndex);
+        ThreadNodes(nodes, sizeM);
+        DeletePtrs(nodes, nodesCap);
+	}
+	void merge_difference(map &other) {
+        if (&other == this) {
+            clear();
+            return;
+        }
+        AdoptNodes(other);
+        root = Subtract(root, other.root);
+        other.Disown();
+        LinkEnd();
 	}
 	void erase(iterator pos) {
         if (pos.ctn != this || pos.p == &pastTheEnd) throw index_out_of_bound();
         --sizeM;
-        if (sizeM == 0) {
-            delete root;
-            root = NULL;
-            beginA = &pastTheEnd;
-            pastTheEnd.prev = NULL;
-            return;
-        }
-        value_type tmp = *(pos.p -> v);
-        Remove(root, tmp, true);
+        Remove(pos.p);
 	}
 
 	size_t count(const Key &key) const {
-        if (find(key).p == &pastTheEnd) return 0;
+        if (FindNode(key) == NULL) return 0;
         else return 1;
 	}
 	iterator find(const Key &key) {
-        AvlTree *t = root;
-        while (t && !EqualKey(t -> v -> first, key)) {
-            if (CmpKey(key, t -> v -> first)) t = t -> l;
-            else t = t -> r;
-        }
+        AvlTree *t = FindNode(key);
         if (!t) return iterator(this, &pastTheEnd);
         else return iterator(this, t);
 	}
 	const_iterator find(const Key &key) const {
-        const AvlTree *t = root;
-        while (t && !EqualKey(t -> v -> first, key)) {
-            if (CmpKey(key, t -> v -> first)) t = t -> l;
-            else t = t -> r;
-        }
+        const AvlTree *t = FindNode(key);
         if (!t) return const_iterator(this, &pastTheEnd);
         else return const_iterator(this, t);
 	}
+	template<class K, class C = Compare, class = typename C::is_transparent>
+	size_t count(const K &key) const {
+        if (FindNode(key) == NULL) return 0;
+        else return 1;
+	}
+	template<class K, class C = Compare, class = typename C::is_transparent>
+	iterator find(const K &key) {
+        AvlTree *t = FindNode(key);
+        if (!t) return iterator(this, &pastTheEnd);
+        else return iterator(this, t);
+	}
+	template<class K, class C = Compare, class = typename C::is_transparent>
+	const_iterator find(const K &key) const {
+        const AvlTree *t = FindNode(key);
+        if (!t) return const_iterator(this, &pastTheEnd);
+        else return const_iterator(this, t);
+	}
+	/**
+	 * find for every key in [first, last), written to out in order; the
+	 * lookups run in groups that overlap their cache misses, which pays
+	 * off once the map no longer fits in cache.  Keys are read more than
+	 * once, hence the forward iterators.
+	 */
+	template<class ForwardIt, class OutputIt>
+	OutputIt find_batch(ForwardIt first, ForwardIt last, OutputIt out) {
+        AvlTree *found[batchLanes];
+        while (first != last) {
+            int n = FindGroup(first, last, found);
+            for (int i = 0; i < n; ++i) *out++ = iterator(this, found[i] ? found[i] : &pastTheEnd);
+        }
+        return out;
+	}
+	template<class ForwardIt, class OutputIt>
+	OutputIt find_batch(ForwardIt first, ForwardIt last, OutputIt out) const {
+        AvlTree *found[batchLanes];
+        while (first != last) {
+            int n = FindGroup(first, last, found);
+            for (int i = 0; i < n; ++i) *out++ = const_iterator(this, found[i] ? found[i] : &pastTheEnd);
+        }
+        return out;
+	}
+
+	iterator lower_bound(const Key &key) {
+        size_t less;
+        return iterator(this, Bound(key, false, less));
+	}
+	const_iterator lower_bound(const Key &key) const {
+        size_t less;
+        return const_iterator(this, Bound(key, false, less));
+	}
+	iterator upper_bound(const Key &key) {
+        size_t less;
+        return iterator(this, Bound(key, true, less));
+	}
+	const_iterator upper_bound(const Key &key) const {
+        size_t less;
+        return const_iterator(this, Bound(key, true, less));
+	}
+	pair<iterator, iterator> equal_range(const Key &key) {
+        return pair<iterator, iterator>(lower_bound(key), upper_bound(key));
+	}
+	pair<const_iterator, const_iterator> equal_range(const Key &key) const {
+        return pair<const_iterator, const_iterator>(lower_bound(key), upper_bound(key));
+	}
+	// number of keys in [lo, hi), from the subtree sizes on two descents
+	size_t count_range(const Key &lo, const Key &hi) const {
+        size_t below, upTo;
+        Bound(lo, false, below);
+        Bound(hi, false, upTo);
+        return upTo > below ? upTo - below : 0;
+	}
+	// the rank key has, or would have once inserted; getByRank(rank_of(key))
+	// finds key when it is present
+	int rank_of(const Key &key) const {
+        size_t less;
+        Bound(key, false, less);
+        return less + 1;
+	}
+
+	/**
+	 * Op's fold, in key order, of the mapped values with keys in [lo, hi):
+	 * one descent to where the bounds part, then one down each side taking
+	 * whole subtrees.  Needs an augmented_policy.  Values changed in place
+	 * (through an iterator or operator[]) must be reported with refresh.
+	 */
+	typename Slot::type aggregate(const Key &lo, const Key &hi) const {
+        AugOp op;
+        const AvlTree *t = root;
+        while (t) {
+            if (CmpKey(t -> v -> first, lo)) t = t -> r;
+            else if (!CmpKey(t -> v -> first, hi)) t = t -> l;
+            else break;
+        }
+        if (t == NULL) return op.identity();
+        typename Slot::type left = op.identity(), right = op.identity();
+        for (const AvlTree *u = t -> l; u; ) {
+            if (CmpKey(u -> v -> first, lo)) u = u -> r;
+            else {
+                if (u -> r) left = op(u -> r -> agg, left);
+                left = op(typename Slot::type(u -> v -> second), left);
+                u = u -> l;
+            }
+        }
+        for (const AvlTree *u = t -> r; u; ) {
+            if (!CmpKey(u -> v -> first, hi)) u = u -> l;
+            else {
+                if (u -> l) right = op(right, u -> l -> agg);
+                right = op(right, typename Slot::type(u -> v -> second));
+                u = u -> r;
+            }
+        }
+        return op(op(left, typename Slot::type(t -> v -> second)), right);
+	}
+	// the fold over the whole map
+	typename Slot::type aggregate() const {
+        if (root == NULL) return AugOp().identity();
+        return root -> agg;
+	}
+	// pos -> second was changed in place: fold the aggregates above it again
+	void refresh(iterator pos) {
+        if (pos.ctn != this || pos.p == &pastTheEnd) throw invalid_iterator();
+        Refold(pos.p);
+	}
 
     iterator getByRank(int k) {
         if (k <= 0 || k > sizeM) throw index_out_of_bound();
@@ -0,0 +1,163 @@
+#ifndef SJTU_MEMORY_RESOURCE_HPP
+#define SJTU_MEMORY_RESOURCE_HPP
+
+#include "utility.hpp"
+#include "vector.hpp"
+#include "small_vector.hpp"
+#include "deque.hpp"
+#include "ring_deque.hpp"
+#include "map.hpp"
+#include "btree_map.hpp"
+#include "flat_map.hpp"
+#include "priority_queue.hpp"
+
+#include <cstddef>
+#include <functional>
+#include <new>
+
+namespace sjtu {
+
+/**
+ * Bump-pointer memory resource.  Memory is carved out of ever larger
+ * chunks and never given back one piece at a time: deallocate() does
+ * nothing and everything is returned by release() or the destructor.
+ * Containers using it must not be touched after the arena is released.
+ */
+class monotonic_arena {
+private:
+    struct Chunk {
+        Chunk *next;
+    };
+    Chunk *head;
+    char *cur, *end;
+    size_t nextChunkSize;
+
+    static char *AlignUp(char *p, size_t align) {
+        size_t mis = reinterpret_cast<size_t>(p) & (align - 1);
+        return mis ? p + (align - mis) : p;
+    }
+    void NewChunk(size_t bytes, size_t align) {
+        size_t need = sizeof(Chunk) + bytes + align;
+        size_t size = nextChunkSize > need ? nextChunkSize : need;
+        Chunk *chunk = static_cast<Chunk*>(::operator new(size));
+        chunk->next = head;
+        head = chunk;
+        cur = reinterpret_cast<char*>(chunk + 1);
+        end = reinterpret_cast<char*>(chunk) + size;
+        nextChunkSize = size << 1;
+    }
+
+public:
+    explicit monotonic_arena(size_t initialSize = 4096):
+        head(NULL), cur(NULL), end(NULL), nextChunkSize(initialSize) {}
+    // serve requests from a caller-owned buffer first (e.g. on the stack)
+    monotonic_arena(void *buffer, size_t size, size_t initialSize = 4096):
+        head(NULL), cur(static_cast<char*>(buffer)), end(static_cast<char*>(buffer) + size),
+        nextChunkSize(initialSize) {}
+    monotonic_arena(const monotonic_arena &) = delete;
+    monotonic_arena &operator=(const monotonic_arena &) = delete;
+    ~monotonic_arena() {
+        release();
+    }
+    void *allocate(size_t bytes, size_t align = alignof(std::max_align_t)) {
+        char *p = cur ? AlignUp(cur, align) : NULL;
+        if (p == NULL || p + bytes > end) {
+            NewChunk(bytes, align);
+            p = AlignUp(cur, align);
+        }
+        cur = p + bytes;
+        return p;
+    }
+    void deallocate(void *, size_t, size_t = alignof(std::max_align_t)) {}
+    // give every chunk back at once; the caller-owned buffer is not reused
+    void release() {
+        while (head) {
+            Chunk *tmp = head;
+            head = head->next;
+            ::operator delete(tmp);
+        }
+        cur = end = NULL;
+    }
+};
+
+/**
+ * Allocator handing out memory from a monotonic_arena.  Like
+ * std::pmr::polymorphic_allocator it stays with its container on copy,
+ * move and swap; a default-constructed one (or a copy-constructed
+ * container) falls back to the global heap.
+ */
+template<class T>
+class arena_allocator {
+    template<class U> friend class arena_allocator;
+private:
+    monotonic_arena *arena;
+public:
+    typedef T value_type;
+    typedef std::false_type propagate_on_container_copy_assignment;
+    typedef std::false_type propagate_on_container_move_assignment;
+    typedef std::false_type propagate_on_container_swap;
+
+    arena_allocator(): arena(NULL) {}
+    arena_allocator(monotonic_arena *a): arena(a) {}
+    template<class U>
+    arena_allocator(const arena_allocator<U> &other): arena(other.arena) {}
+
+    T *allocate(size_t n) {
+        if (arena) return static_cast<T*>(arena->allocate(n * sizeof(T), alignof(T)));
+        return static_cast<T*>(::operator new(n * sizeof(T)));
+    }
+    void deallocate(T *p, size_t) {
+        if (!arena) ::operator delete(p);
+    }
+    arena_allocator select_on_container_copy_construction() const {
+        return arena_allocator();
+    }
+    monotonic_arena *resource() const {
+        return arena;
+    }
+    template<class U>
+    bool operator==(const arena_allocator<U> &rhs) const {
+        return arena == rhs.arena;
+    }
+    template<class U>
+    bool operator!=(const arena_allocator<U> &rhs) const {
+        return arena != rhs.arena;
+    }
+};
+
+template<class T>
+bool skips_deallocate(const arena_allocator<T> &alloc) {
+    return alloc.resource() != NULL;
+}
+
+namespace pmr {
+
+template<class T>
+using vector = sjtu::vector<T, arena_allocator<T>>;
+
+template<class T, size_t N>
+using small_vector = sjtu::small_vector<T, N, arena_allocator<T>>;
+
+template<class T>
+using deque = sjtu::deque<T, arena_allocator<T>>;
+
+template<class T>
+using ring_deque = sjtu::ring_deque<T, arena_allocator<T>>;
+
+template<class Key, class T, class Compare = std::less<Key>>
+using map = sjtu::map<Key, T, Compare, arena_allocator<pair<const Key, T>>>;
+
+template<class Key, class T, class Compare = std::less<Key>>
+using btree_map = sjtu::btree_map<Key, T, Compare, arena_allocator<pair<const Key, T>>>;
+
+template<class Key, class T, class Compare = std::less<Key>>
+using flat_map = sjtu::flat_map<Key, T, Compare, arena_allocator<pair<const Key, T>>>;
+
+template<class T, class Compare = std::less<T>>
+using priority_queue = sjtu::priority_queue<T, Compare, arena_allocator<T>>;
+
+}
+
+}
+
+#endif
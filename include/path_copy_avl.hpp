@@ -0,0 +1,103 @@
+#ifndef SJTU_PATH_COPY_AVL_HPP
+#define SJTU_PATH_COPY_AVL_HPP
+
+#include <cstddef>
+#include <memory>
+#include <utility>
+#include "utility.hpp"
+
+namespace sjtu {
+
+/**
+ * The AVL core of persistent_map and concurrent_map, whose writes copy
+ * the path they touch instead of changing shared nodes.  Derived provides
+ *     void Own(Node *&link);       // make *link a node this write may change
+ *     static void Update(Node *t); // recompute h (and anything else) from t's children
+ * and Node has members h, l and r.  Rotations own the child they lift
+ * before relinking it; the grandchild that changes parent is only relinked.
+ */
+template<class Derived, class Node, class Allocator>
+class PathCopyAvl {
+protected:
+    // AVL height stays below 1.45 log2(n + 2), and n < 2^43 nodes fit in memory
+    static const int maxDepth = 64;
+    typedef std::allocator_traits<Allocator> alloc_traits;
+    typedef typename alloc_traits::template rebind_alloc<Node> NodeAlloc;
+    typedef std::allocator_traits<NodeAlloc> node_traits;
+
+    Allocator alloc;
+
+    PathCopyAvl() {}
+    explicit PathCopyAvl(const Allocator &a): alloc(a) {}
+
+    Derived &Self() {
+        return static_cast<Derived&>(*this);
+    }
+
+    template<class... Args>
+    Node *NewNode(Args&&... args) {
+        NodeAlloc nodeAlloc(alloc);
+        Node *t = node_traits::allocate(nodeAlloc, 1);
+        try {
+            node_traits::construct(nodeAlloc, t, std::forward<Args>(args)...);
+        }
+        catch (...) {
+            node_traits::deallocate(nodeAlloc, t, 1);
+            throw;
+        }
+        return t;
+    }
+    void DeleteNode(Node *t) {
+        NodeAlloc nodeAlloc(alloc);
+        node_traits::destroy(nodeAlloc, t);
+        node_traits::deallocate(nodeAlloc, t, 1);
+    }
+
+    static int GetH(const Node *p) {
+        if (!p) return -1;
+        return p -> h;
+    }
+    void LL(Node *&t) {
+        Self().Own(t -> l);
+        Node *t1 = t -> l;
+        t -> l = t1 -> r;
+        t1 -> r = t;
+        Derived::Update(t);
+        Derived::Update(t1);
+        t = t1;
+    }
+    void RR(Node *&t) {
+        Self().Own(t -> r);
+        Node *t1 = t -> r;
+        t -> r = t1 -> l;
+        t1 -> l = t;
+        Derived::Update(t);
+        Derived::Update(t1);
+        t = t1;
+    }
+    void LR(Node *&t) {
+        Self().Own(t -> l);
+        RR(t -> l);
+        LL(t);
+    }
+    void RL(Node *&t) {
+        Self().Own(t -> r);
+        LL(t -> r);
+        RR(t);
+    }
+    void Balance(Node *&t) {
+        if (GetH(t -> l) - GetH(t -> r) == 2) {
+            if (GetH(t -> l -> l) >= GetH(t -> l -> r)) LL(t);
+            else LR(t);
+        }
+        else if (GetH(t -> r) - GetH(t -> l) == 2) {
+            if (GetH(t -> r -> r) >= GetH(t -> r -> l)) RR(t);
+            else RL(t);
+        }
+        else Derived::Update(t);
+    }
+};
+
+}
+
+#endif
@@ -0,0 +1,425 @@
+#ifndef SJTU_PERSISTENT_MAP_HPP
+#define SJTU_PERSISTENT_MAP_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <utility>
+#include "utility.hpp"
+#include "exceptions.hpp"
+#include "path_copy_avl.hpp"
+
+namespace sjtu {
+
+template<class V>
+struct PersistentNode {
+    std::atomic<size_t> refs;  // versions and parents that hold it
+    size_t sizeT;
+    int h;  // -1 once it is being freed
+    PersistentNode *l, *r;
+    V val;
+    template<class... Args>
+    PersistentNode(Args&&... args): refs(1), sizeT(1), h(0), l(NULL), r(NULL), val(std::forward<Args>(args)...) {}
+};
+
+/**
+ * AVL map whose versions share nodes.  A copy, or snapshot(), takes the
+ * root in O(1); a write then copies only the nodes on its path that
+ * another version still holds (O(log n)), and frees the old ones once no
+ * version holds them.  Nodes have no parent links or thread list, which
+ * could not be shared, so iterators carry the path from the root.
+ *
+ * Versions may be read and released from different threads at once; one
+ * version is written (or snapshotted) by one thread at a time.  Values are
+ * read-only through iterators and change only through at, operator[] and
+ * insert_or_assign.  Iterators stay valid until their version is written.
+ */
+template<
+	class Key,
+	class T,
+	class Compare = std::less<Key>,
+	class Allocator = std::allocator<pair<const Key, T>>
+> class persistent_map : PathCopyAvl<persistent_map<Key, T, Compare, Allocator>, PersistentNode<pair<const Key, T>>, Allocator> {
+public:
+    typedef pair<const Key, T> value_type;
+    typedef Allocator allocator_type;
+private:
+    typedef PersistentNode<value_type> Node;
+    typedef PathCopyAvl<persistent_map, Node, Allocator> Core;
+    friend Core;
+    using Core::maxDepth;
+    using Core::alloc;
+    using Core::NewNode;
+    using Core::DeleteNode;
+    using Core::GetH;
+    using Core::Balance;
+
+    Compare CmpKey;
+    Node *root;
+    static void Retain(Node *t) {
+        if (t) t -> refs.fetch_add(1, std::memory_order_relaxed);
+    }
+    // true if that was the last reference
+    static bool Unref(Node *t) {
+        return t -> refs.fetch_sub(1, std::memory_order_acq_rel) == 1;
+    }
+    // t has no references left: drop the ones it holds on its children,
+    // keeping only the links to children that are now ours to free
+    static void Claim(Node *t) {
+        if (t -> h < 0) return;
+        t -> h = -1;
+        if (t -> l && !Unref(t -> l)) t -> l = NULL;
+        if (t -> r && !Unref(t -> r)) t -> r = NULL;
+    }
+    // drop a reference to t and free whatever nobody holds any more,
+    // rotating left children up into a right spine instead of recursing
+    void Release(Node *t) {
+        if (t == NULL || !Unref(t)) return;
+        while (t) {
+            Claim(t);
+            if (t -> l) {
+                Node *t1 = t -> l;
+                Claim(t1);
+                t -> l = t1 -> r;
+                t1 -> r = t;
+                t = t1;
+            }
+            else {
+                Node *next = t -> r;
+                DeleteNode(t);
+                t = next;
+            }
+        }
+    }
+    // make the node at link ours alone, copying it if another version
+    // holds it; the copy holds the same children
+    void Own(Node *&link) {
+        Node *t = link;
+        if (t -> refs.load(std::memory_order_acquire) == 1) return;
+        Node *t1 = NewNode(t -> val);
+        t1 -> sizeT = t -> sizeT;
+        t1 -> h = t -> h;
+        t1 -> l = t -> l;
+        t1 -> r = t -> r;
+        Retain(t1 -> l);
+        Retain(t1 -> r);
+        link = t1;
+        Release(t);
+    }
+
+    static size_t GetSizeT(const Node *p) {
+        if (!p) return 0;
+        return p -> sizeT;
+    }
+    static void Update(Node *t) {
+        t -> sizeT = GetSizeT(t -> l) + GetSizeT(t -> r) + 1;
+        t -> h = gmax(GetH(t -> l), GetH(t -> r)) + 1;
+    }
+
+    const Node *Find(const Key &key) const {
+        const Node *t = root;
+        while (t) {
+            if (CmpKey(key, t -> val.first)) t = t -> l;
+            else if (CmpKey(t -> val.first, key)) t = t -> r;
+            else return t;
+        }
+        return NULL;
+    }
+    // copy the path to key so this version owns it; path[i] is the link to
+    // the node at depth i.  Returns the depth reached: at the node holding
+    // key, or at the empty link where it would go
+    int OwnPath(const Key &key, Node **path[]) {
+        int depth = 0;
+        Node **link = &root;
+        while (*link) {
+            Own(*link);
+            path[depth++] = link;
+            Node *t = *link;
+            if (CmpKey(key, t -> val.first)) link = &(t -> l);
+            else if (CmpKey(t -> val.first, key)) link = &(t -> r);
+            else return depth - 1;
+        }
+        path[depth] = link;
+        return depth;
+    }
+    // the node holding key, made by make() and linked in if it is absent;
+    // either way the path to it is ours afterwards
+    template<class Make>
+    Node *Insert(const Key &key, bool &inserted, const Make &make) {
+        Node **path[maxDepth + 1];
+        int depth = OwnPath(key, path);
+        if (*path[depth]) {
+            inserted = false;
+            return *path[depth];
+        }
+        Node *ret = make();
+        inserted = true;
+        *path[depth] = ret;
+        while (depth > 0) Balance(*path[--depth]);
+        return ret;
+    }
+    void Remove(const Key &key) {
+        Node **path[maxDepth + 1];
+        int depth = OwnPath(key, path);
+        Node *x = *path[depth];
+        if (x -> l && x -> r) {
+            // the successor takes x's place; the path runs on down to it
+            int top = depth;
+            Node **link = &(x -> r);
+            while (true) {
+                Own(*link);
+                path[++depth] = link;
+                if ((*link) -> l == NULL) break;
+                link = &((*link) -> l);
+            }
+            Node *s = *link;
+            *link = s -> r;
+            s -> l = x -> l;
+            s -> r = x -> r;
+            *path[top] = s;
+            if (depth > top + 1) path[top + 1] = &(s -> r);
+        }
+        else *path[depth] = x -> l ? x -> l : x -> r;
+        x -> l = x -> r = NULL;
+        DeleteNode(x);
+        while (depth > 0) Balance(*path[--depth]);
+    }
+    const Node *GetKth(const Node *t, size_t k) const {
+        while (true) {
+            if (k <= GetSizeT(t -> l)) {
+                t = t -> l;
+                continue;
+            }
+            k -= GetSizeT(t -> l);
+            if (k == 1) return t;
+            --k;
+            t = t -> r;
+        }
+    }
+
+public:
+	class const_iterator {
+        friend class persistent_map;
+    private:
+        const persistent_map *ctn;
+        const Node *path[maxDepth];  // root down to the current node; empty at end()
+        int depth;
+        const_iterator(const persistent_map *ctnA): ctn(ctnA), depth(0) {}
+        void PushLeftmost(const Node *t) {
+            for (; t; t = t -> l) path[depth++] = t;
+        }
+        void PushRightmost(const Node *t) {
+            for (; t; t = t -> r) path[depth++] = t;
+        }
+        const Node *Cur() const {
+            return depth ? path[depth - 1] : NULL;
+        }
+    public:
+        const_iterator(): ctn(NULL), depth(0) {}
+        const_iterator(const const_iterator &other): ctn(other.ctn), depth(other.depth) {
+            for (int i = 0; i < depth; ++i) path[i] = other.path[i];
+        }
+        const_iterator & operator=(const const_iterator &other) {
+            ctn = other.ctn;
+            depth = other.depth;
+            for (int i = 0; i < depth; ++i) path[i] = other.path[i];
+            return *this;
+        }
+        const_iterator operator++(int) {
+            const_iterator tmp(*this);
+            ++*this;
+            return tmp;
+		}
+		const_iterator & operator++() {
+            if (depth == 0) throw invalid_iterator();
+            const Node *t = path[depth - 1];
+            if (t -> r) PushLeftmost(t -> r);
+            else {
+                // climb until we come up out of a left subtree
+                do {
+                    t = path[--depth];
+                } while (depth > 0 && path[depth - 1] -> r == t);
+            }
+            return *this;
+		}
+		const_iterator operator--(int) {
+            const_iterator tmp(*this);
+            --*this;
+            return tmp;
+		}
+		const_iterator & operator--() {
+            if (depth == 0) {
+                if (ctn == NULL || ctn -> root == NULL) throw invalid_iterator();
+                PushRightmost(ctn -> root);
+                return *this;
+            }
+            const Node *t = path[depth - 1];
+            if (t -> l) {
+                PushRightmost(t -> l);
+                return *this;
+            }
+            int oldDepth = depth;
+            do {
+                t = path[--depth];
+            } while (depth > 0 && path[depth - 1] -> l == t);
+            if (depth == 0) {
+                // already at begin()
+                depth = oldDepth;
+                throw invalid_iterator();
+            }
+            return *this;
+		}
+		const value_type & operator*() const {
+            if (depth == 0) throw invalid_iterator();
+            return Cur() -> val;
+		}
+		const value_type* operator->() const {
+            if (depth == 0) throw invalid_iterator();
+            return &(Cur() -> val);
+		}
+		bool operator==(const const_iterator &rhs) const {
+            return (ctn == rhs.ctn) && (Cur() == rhs.Cur());
+		}
+		bool operator!=(const const_iterator &rhs) const {
+		    return (ctn != rhs.ctn) || (Cur() != rhs.Cur());
+		}
+	};
+	typedef const_iterator iterator;
+
+	persistent_map(): root(NULL) {}
+	explicit persistent_map(const Allocator &a): Core(a), root(NULL) {}
+	// shares other's tree
+	persistent_map(const persistent_map &other): Core(other.alloc), CmpKey(other.CmpKey), root(other.root) {
+        Retain(root);
+	}
+	persistent_map(persistent_map &&other): Core(other.alloc), CmpKey(other.CmpKey), root(other.root) {
+        other.root = NULL;
+	}
+	persistent_map & operator=(const persistent_map &other) {
+        if (&other == this) return *this;
+        Retain(other.root);
+        Release(root);
+        CmpKey = other.CmpKey;
+        alloc = other.alloc;
+        root = other.root;
+        return *this;
+	}
+	persistent_map & operator=(persistent_map &&other) {
+        if (&other == this) return *this;
+        Release(root);
+        CmpKey = other.CmpKey;
+        alloc = other.alloc;
+        root = other.root;
+        other.root = NULL;
+        return *this;
+	}
+	~persistent_map() {
+        Release(root);
+	}
+	// a frozen copy of this version, in O(1)
+	persistent_map snapshot() const {
+        return persistent_map(*this);
+	}
+	void swap(persistent_map &other) {
+        std::swap(CmpKey, other.CmpKey);
+        std::swap(alloc, other.alloc);
+        std::swap(root, other.root);
+	}
+	allocator_type get_allocator() const {
+        return alloc;
+	}
+
+	// copies the path to key, as any write does
+	T & at(const Key &key) {
+        if (Find(key) == NULL) throw index_out_of_bound();
+        Node **path[maxDepth + 1];
+        return (*path[OwnPath(key, path)]) -> val.second;
+	}
+	const T & at(const Key &key) const {
+        const Node *t = Find(key);
+        if (!t) throw index_out_of_bound();
+        return t -> val.second;
+	}
+	T & operator[](const Key &key) {
+        bool inserted;
+        return Insert(key, inserted, [&]() {
+            return NewNode(key, T());
+        }) -> val.second;
+	}
+	const T & operator[](const Key &key) const {
+        return at(key);
+	}
+
+	const_iterator begin() const {
+        const_iterator ret(this);
+        ret.PushLeftmost(root);
+        return ret;
+    }
+	const_iterator cbegin() const {
+        return begin();
+	}
+	const_iterator end() const {
+        return const_iterator(this);
+	}
+	const_iterator cend() const {
+        return end();
+	}
+	bool empty() const {
+        return root == NULL;
+	}
+	size_t size() const {
+        return GetSizeT(root);
+	}
+	void clear() {
+        Release(root);
+        root = NULL;
+	}
+	pair<iterator, bool> insert(const value_type &value) {
+        if (Find(value.first)) return pair<iterator, bool>(find(value.first), false);
+        bool inserted;
+        Insert(value.first, inserted, [&]() {
+            return NewNode(value);
+        });
+        return pair<iterator, bool>(find(value.first), inserted);
+	}
+	template<class M>
+	pair<iterator, bool> insert_or_assign(const Key &key, M &&obj) {
+        bool inserted;
+        Node *t = Insert(key, inserted, [&]() {
+            return NewNode(key, std::forward<M>(obj));
+        });
+        if (!inserted) t -> val.second = std::forward<M>(obj);
+        return pair<iterator, bool>(find(key), inserted);
+	}
+	void erase(const_iterator pos) {
+        if (pos.ctn != this || pos.depth == 0) throw index_out_of_bound();
+        // pos's node may be freed once its path is copied: keep the key only
+        Key key = pos.Cur() -> val.first;
+        Remove(key);
+	}
+
+	size_t count(const Key &key) const {
+        return Find(key) ? 1 : 0;
+	}
+	const_iterator find(const Key &key) const {
+        const_iterator ret(this);
+        const Node *t = root;
+        while (t) {
+            ret.path[ret.depth++] = t;
+            if (CmpKey(key, t -> val.first)) t = t -> l;
+            else if (CmpKey(t -> val.first, key)) t = t -> r;
+            else return ret;
+        }
+        return end();
+	}
+
+    const_iterator getByRank(int k) const {
+        if (k <= 0 || size_t(k) > size()) throw index_out_of_bound();
+        return find(GetKth(root, k) -> val.first);
+    }
+};
+
+}
+
+#endif
@@ -3,7 +3,11 @@
 
 #include <cstddef>
 #include <functional>
+#include <memory>
+#include <type_traits>
+#include <utility>
 #include "exceptions.hpp"
+#include "utility.hpp"
 
 namespace sjtu {
 
@@ -13,39 +17,74 @@ void swap(T &a, T &b) {
     a = b; b = tmp;
 }
 
-template<typename T, class Compare = std::less<T>>
+template<typename T, class Compare = std::less<T>, class Allocator = std::allocator<T>>
 class priority_queue {
+public:
+    typedef Allocator allocator_type;
 private:
     struct Tree {
         T *x;
         int d;
         Tree *l, *r;
 
-        Tree(): x(NULL), l(NULL), r(NULL) {}
-        Tree(const T &e): x(new T(e)), d(0), l(NULL), r(NULL) {}
-        ~Tree() {
-            if (x) delete x;
-            if (l) delete l;
-            if (r) delete r;
-        }
-        void copy(const Tree &obj) {
-            if (x) delete x;
-            x = new T(*obj.x);
-            d = obj.d;
-            if (l) delete l;
-            if (r) delete r;
-            if (obj.l) {
-                l = new Tree;
-                l -> copy(*obj.l);
+        Tree(): x(NULL), d(0), l(NULL), r(NULL) {}
+    };
+    typedef std::allocator_traits<Allocator> alloc_traits;
+    typedef typename alloc_traits::template rebind_alloc<Tree> TreeAlloc;
+    typedef std::allocator_traits<TreeAlloc> tree_traits;
+
+    Allocator alloc;
+
+    Tree *NewTree(const T &e) {
+        TreeAlloc treeAlloc(alloc);
+        Tree *t = tree_traits::allocate(treeAlloc, 1);
+        tree_traits::construct(treeAlloc, t);
+        try {
+            t -> x = alloc_traits::allocate(alloc, 1);
+            try {
+                alloc_traits::construct(alloc, t -> x, e);
             }
-            else l = NULL;
-            if (obj.r) {
-                r = new Tree;
-                r -> copy(*obj.r);
+            catch (...) {
+                alloc_traits::deallocate(alloc, t -> x, 1);
+                throw;
             }
-            else r = NULL;
         }
-    };
+        catch (...) {
+            tree_traits::destroy(treeAlloc, t);
+            tree_traits::deallocate(treeAlloc, t, 1);
+            throw;
+        }
+        return t;
+    }
+    void DeleteTree(Tree *t) {
+        TreeAlloc treeAlloc(alloc);
+        alloc_traits::destroy(alloc, t -> x);
+        alloc_traits::deallocate(alloc, t -> x, 1);
+        tree_traits::destroy(treeAlloc, t);
+        tree_traits::deallocate(treeAlloc, t, 1);
+    }
+    void DestroyTree(Tree *t) {
+        if (t == NULL) return;
+        // arena allocators drop every node at once; nothing to visit
+        if (skips_deallocate(alloc) && std::is_trivially_destructible<T>::value) return;
+        DestroyTree(t -> l);
+        DestroyTree(t -> r);
+        DeleteTree(t);
+    }
+    Tree *CloneTree(const Tree *obj) {
+        if (obj == NULL) return NULL;
+        Tree *t = NewTree(*(obj -> x));
+        t -> d = obj -> d;
+        try {
+            t -> l = CloneTree(obj -> l);
+            t -> r = CloneTree(obj -> r);
+        }
+        catch (...) {
+            DestroyTree(t);
+            throw;
+        }
+        return t;
+    }
 
     static int TreeDist(Tree *t) {
         if (t == NULL) return -1;
@@ -55,9 +94,9 @@ private:
         Compare Cmp;
         if (t1 == NULL) return t2;
         if (t2 == NULL) return t1;
-        if (Cmp(*(t1 -> x), *(t2 -> x))) swap(t1, t2);
+        if (Cmp(*(t1 -> x), *(t2 -> x))) sjtu::swap(t1, t2);
         t1 -> r = TreeMerge(t1 -> r, t2);
-        if (TreeDist(t1 -> l) < TreeDist(t1 -> r)) swap(t1 -> l, t1 -> r);
+        if (TreeDist(t1 -> l) < TreeDist(t1 -> r)) sjtu::swap(t1 -> l, t1 -> r);
         t1 -> d = TreeDist(t1 -> r) + 1;
         return t1;
     }
@@ -67,34 +106,72 @@ private:
 public:
 	priority_queue(): root(NULL), n(0) {
 	}
-	priority_queue(const priority_queue &other): n(other.n) {
-        if (other.root) {
-            root = new Tree;
-            root -> copy(*other.root);
-        }
-        else root = NULL;
+	explicit priority_queue(const Allocator &a): alloc(a), root(NULL), n(0) {
+	}
+	priority_queue(const priority_queue &other):
+	    alloc(alloc_traits::select_on_container_copy_construction(other.alloc)), n(other.n) {
+        root = CloneTree(other.root);
+	}
+	priority_queue(priority_queue &&other):
+	    alloc(std::move(other.alloc)), root(other.root), n(other.n) {
+        other.root = NULL;
+        other.n = 0;
 	}
 	~priority_queue() {
-        if (root) delete root;
+        DestroyTree(root);
 	}
 	priority_queue &operator=(const priority_queue &other) {
         if (this == &other) return *this;
+        DestroyTree(root);
+        root = NULL;
+        n = 0;
+        if (alloc_traits::propagate_on_container_copy_assignment::value)
+            alloc = other.alloc;
+        root = CloneTree(other.root);
         n = other.n;
-        if (root) delete root;
-        if (other.root) {
-            root = new Tree;
-            root -> copy(*other.root);
+        return *this;
+	}
+	priority_queue &operator=(priority_queue &&other) {
+        if (this == &other) return *this;
+        DestroyTree(root);
+        root = NULL;
+        n = 0;
+        if (alloc_traits::propagate_on_container_move_assignment::value)
+            alloc = std::move(other.alloc);
+        else if (!(alloc == other.alloc)) {
+            // nodes from a foreign allocator must be rebuilt with ours
+            root = CloneTree(other.root);
+            n = other.n;
+            other.clear();
+            return *this;
         }
-        else root = NULL;
+        root = other.root;
+        n = other.n;
+        other.root = NULL;
+        other.n = 0;
         return *this;
 	}
+	void swap(priority_queue &other) {
+        if (alloc_traits::propagate_on_container_swap::value)
+            std::swap(alloc, other.alloc);
+        std::swap(root, other.root);
+        std::swap(n, other.n);
+	}
+	allocator_type get_allocator() const {
+        return alloc;
+	}
+	void clear() {
+        DestroyTree(root);
+        root = NULL;
+        n = 0;
+	}
 	const T & top() const {
         if (n == 0) throw container_is_empty();
         return *(root -> x);
 	}
 	void push(const T &e) {
+        Tree *p = NewTree(e);
 	    ++n;
-        Tree *p = new Tree(e);
         root = TreeMerge(root, p);
 	}
 	void pop() {
@@ -102,8 +179,7 @@ public:
         --n;
         Tree *tmp = root;
         root = TreeMerge(tmp -> l, tmp -> r);
-        tmp -> l = tmp -> r = NULL;
-        delete tmp;
+        DeleteTree(tmp);
 	}
 	size_t size() const {
         return n;
@@ -112,6 +188,15 @@ public:
         return (n == 0);
 	}
 	void merge(priority_queue &other) {
+        if (this == &other) return;
+        if (!(alloc == other.alloc)) {
+            // other's nodes cannot be freed by our allocator: merge copies
+            Tree *copy = CloneTree(other.root);
+            n += other.n;
+            root = TreeMerge(root, copy);
+            other.clear();
+            return;
+        }
         n += other.n;
         root = TreeMerge(root, other.root);
         other.root = NULL;
@@ -0,0 +1,479 @@
+#ifndef SJTU_RING_DEQUE_HPP
+#define SJTU_RING_DEQUE_HPP
+
+#include "exceptions.hpp"
+
+#include <cstddef>
+#include <memory>
+#include <utility>
+
+namespace sjtu {
+
+// elements per ring_deque block: a power of two filling about 4KB, at least 16
+constexpr size_t ring_block_size(size_t elemSize, size_t n = 16) {
+    return n * 2 * elemSize > 4096 ? n : ring_block_size(elemSize, n * 2);
+}
+
+/**
+ * Deque for workloads that push and pop at the ends.  Fixed-size blocks are
+ * referenced from a circular map, so operator[] is O(1) and pushes at
+ * either end are amortized O(1); insert and erase in the middle move the
+ * elements on the shorter side.  Same interface, iterators and exceptions
+ * as sjtu::deque.
+ */
+template<class T, class Allocator = std::allocator<T>>
+class ring_deque {
+public:
+    typedef Allocator allocator_type;
+private:
+    static const size_t blockSize = ring_block_size(sizeof(T));
+    typedef std::allocator_traits<Allocator> alloc_traits;
+    typedef typename alloc_traits::template rebind_alloc<T*> MapAlloc;
+    typedef std::allocator_traits<MapAlloc> map_traits;
+
+    Allocator alloc;
+    T **blocks;       // circular; NULL where no element lives
+    size_t mapCap;    // number of block slots, a power of two
+    size_t head;      // slot of element 0, in [0, mapCap * blockSize)
+    size_t sizeD;
+    T *spare;         // last freed block, kept to avoid churn at a boundary
+
+    size_t SlotMask() const {
+        return mapCap * blockSize - 1;
+    }
+    T *Slot(size_t i) const {
+        size_t s = (head + i) & SlotMask();
+        return blocks[s / blockSize] + (s & (blockSize - 1));
+    }
+    // blocks touched by n elements starting at offset off of a block
+    static size_t Span(size_t off, size_t n) {
+        return (off + n + blockSize - 1) / blockSize;
+    }
+    T *AllocBlock() {
+        T *ret = spare;
+        spare = NULL;
+        if (ret == NULL) ret = alloc_traits::allocate(alloc, blockSize);
+        return ret;
+    }
+    void FreeBlock(T *block) {
+        if (spare == NULL) spare = block;
+        else alloc_traits::deallocate(alloc, block, blockSize);
+    }
+    // double the map, laying the used blocks out from slot 0
+    void GrowMap() {
+        size_t newCap = mapCap ? mapCap << 1 : 8;
+        MapAlloc mapAlloc(alloc);
+        T **newBlocks = map_traits::allocate(mapAlloc, newCap);
+        for (size_t i = 0; i < newCap; ++i)
+            newBlocks[i] = NULL;
+        if (blocks) {
+            size_t first = head / blockSize;
+            size_t cnt = sizeD ? Span(head & (blockSize - 1), sizeD) : 0;
+            for (size_t i = 0; i < cnt; ++i)
+                newBlocks[i] = blocks[(first + i) & (mapCap - 1)];
+            map_traits::deallocate(mapAlloc, blocks, mapCap);
+        }
+        blocks = newBlocks;
+        mapCap = newCap;
+        head &= blockSize - 1;
+    }
+    // make room for one more element at the front / back and return its
+    // raw slot; DropFront / DropBack undo it
+    T *GrowFront() {
+        size_t off = head & (blockSize - 1);
+        if (mapCap == 0 || Span(off == 0 ? blockSize - 1 : off - 1, sizeD + 1) > mapCap) GrowMap();
+        // head moves only once the block is there, so a failed allocation
+        // leaves the deque as it was
+        size_t s = (head + SlotMask()) & SlotMask();
+        T *&block = blocks[s / blockSize];
+        if (block == NULL) block = AllocBlock();
+        head = s;
+        ++sizeD;
+        return block + (s & (blockSize - 1));
+    }
+    T *GrowBack() {
+        if (mapCap == 0 || Span(head & (blockSize - 1), sizeD + 1) > mapCap) GrowMap();
+        size_t s = (head + sizeD) & SlotMask();
+        T *&block = blocks[s / blockSize];
+        if (block == NULL) block = AllocBlock();
+        ++sizeD;
+        return block + (s & (blockSize - 1));
+    }
+    // forget the (already destroyed) first / last element
+    void DropFront() {
+        size_t s = head;
+        head = (head + 1) & SlotMask();
+        --sizeD;
+        if ((s & (blockSize - 1)) == blockSize - 1 || sizeD == 0) {
+            FreeBlock(blocks[s / blockSize]);
+            blocks[s / blockSize] = NULL;
+        }
+    }
+    void DropBack() {
+        size_t s = (head + sizeD - 1) & SlotMask();
+        --sizeD;
+        if ((s & (blockSize - 1)) == 0 || sizeD == 0) {
+            FreeBlock(blocks[s / blockSize]);
+            blocks[s / blockSize] = NULL;
+        }
+    }
+    // move elements [from, to) one slot towards the front / back; the slot
+    // they leave is raw afterwards
+    void MoveDown(size_t from, size_t to) {
+        for (size_t i = from; i < to; ++i) {
+            alloc_traits::construct(alloc, Slot(i - 1), std::move(*Slot(i)));
+            alloc_traits::destroy(alloc, Slot(i));
+        }
+    }
+    void MoveUp(size_t from, size_t to) {
+        for (size_t i = to; i > from; --i) {
+            alloc_traits::construct(alloc, Slot(i), std::move(*Slot(i - 1)));
+            alloc_traits::destroy(alloc, Slot(i - 1));
+        }
+    }
+    void CopyFrom(const ring_deque &other) {
+        for (size_t i = 0; i < other.sizeD; ++i)
+            push_back(*other.Slot(i));
+    }
+    void StealFrom(ring_deque &other) {
+        blocks = other.blocks;
+        mapCap = other.mapCap;
+        head = other.head;
+        sizeD = other.sizeD;
+        spare = other.spare;
+        other.blocks = NULL;
+        other.spare = NULL;
+        other.mapCap = other.head = other.sizeD = 0;
+    }
+    void FreeAll() {
+        clear();
+        if (spare) alloc_traits::deallocate(alloc, spare, blockSize);
+        spare = NULL;
+        if (blocks) {
+            MapAlloc mapAlloc(alloc);
+            map_traits::deallocate(mapAlloc, blocks, mapCap);
+        }
+        blocks = NULL;
+        mapCap = head = 0;
+    }
+
+public:
+	class const_iterator;
+	class iterator {
+        friend ring_deque;
+	private:
+        ring_deque *ctn;
+        size_t idx;
+        iterator(ring_deque *_ctn, size_t _idx): ctn(_ctn), idx(_idx) {}
+	public:
+        iterator(): ctn(NULL), idx(0) {}
+        iterator(const iterator &other): ctn(other.ctn), idx(other.idx) {}
+		iterator operator+(const int &n) const {
+            return iterator(ctn, idx + n);
+		}
+		iterator operator-(const int &n) const {
+            return iterator(ctn, idx - n);
+		}
+		int operator-(const iterator &rhs) const {
+            if (ctn != rhs.ctn) throw invalid_iterator();
+            return (int)idx - (int)rhs.idx;
+		}
+		iterator operator+=(const int &n) {
+            idx += n;
+            return *this;
+		}
+		iterator operator-=(const int &n) {
+            idx -= n;
+            return *this;
+        }
+		iterator operator++(int) {
+		    if (idx >= ctn->sizeD) throw invalid_iterator();
+            iterator ret(*this);
+            ++idx;
+            return ret;
+		}
+		iterator& operator++() {
+		    if (idx >= ctn->sizeD) throw invalid_iterator();
+            ++idx;
+            return *this;
+		}
+		iterator operator--(int) {
+		    if (idx == 0) throw invalid_iterator();
+            iterator ret(*this);
+            --idx;
+            return ret;
+		}
+		iterator& operator--() {
+		    if (idx == 0) throw invalid_iterator();
+            --idx;
+            return *this;
+        }
+		T& operator*() const {
+		    if (idx >= ctn->sizeD) throw invalid_iterator();
+            return *(ctn->Slot(idx));
+		}
+		T* operator->() const noexcept {
+            return ctn->Slot(idx);
+		}
+		bool operator==(const iterator &rhs) const {
+            return (ctn == rhs.ctn) && (idx == rhs.idx);
+		}
+		bool operator==(const const_iterator &rhs) const {
+            return (ctn == rhs.ctn) && (idx == rhs.idx);
+		}
+		bool operator!=(const iterator &rhs) const {
+            return (ctn != rhs.ctn) || (idx != rhs.idx);
+		}
+		bool operator!=(const const_iterator &rhs) const {
+		    return (ctn != rhs.ctn) || (idx != rhs.idx);
+		}
+	};
+	class const_iterator {
+        friend ring_deque;
+    private:
+        const ring_deque *ctn;
+        size_t idx;
+        const_iterator(const ring_deque *_ctn, size_t _idx): ctn(_ctn), idx(_idx) {}
+    public:
+        const_iterator(): ctn(NULL), idx(0) {}
+        const_iterator(const const_iterator &other): ctn(other.ctn), idx(other.idx) {}
+        const_iterator(const iterator &other): ctn(other.ctn), idx(other.idx) {}
+		const_iterator operator+(const int &n) const {
+            return const_iterator(ctn, idx + n);
+		}
+		const_iterator operator-(const int &n) const {
+            return const_iterator(ctn, idx - n);
+		}
+		int operator-(const const_iterator &rhs) const {
+            if (ctn != rhs.ctn) throw invalid_iterator();
+            return (int)idx - (int)rhs.idx;
+		}
+		const_iterator operator+=(const int &n) {
+            idx += n;
+            return *this;
+		}
+		const_iterator operator-=(const int &n) {
+            idx -= n;
+            return *this;
+        }
+		const_iterator operator++(int) {
+		    if (idx >= ctn->sizeD) throw invalid_iterator();
+            const_iterator ret(*this);
+            ++idx;
+            return ret;
+		}
+		const_iterator& operator++() {
+		    if (idx >= ctn->sizeD) throw invalid_iterator();
+            ++idx;
+            return *this;
+		}
+		const_iterator operator--(int) {
+		    if (idx == 0) throw invalid_iterator();
+            const_iterator ret(*this);
+            --idx;
+            return ret;
+		}
+		const_iterator& operator--() {
+		    if (idx == 0) throw invalid_iterator();
+            --idx;
+            return *this;
+        }
+		const T& operator*() const {
+		    if (idx >= ctn->sizeD) throw invalid_iterator();
+            return *(ctn->Slot(idx));
+		}
+		const T* operator->() const noexcept {
+            return ctn->Slot(idx);
+		}
+		bool operator==(const iterator &rhs) const {
+            return (ctn == rhs.ctn) && (idx == rhs.idx);
+		}
+		bool operator==(const const_iterator &rhs) const {
+            return (ctn == rhs.ctn) && (idx == rhs.idx);
+		}
+		bool operator!=(const iterator &rhs) const {
+            return (ctn != rhs.ctn) || (idx != rhs.idx);
+		}
+		bool operator!=(const const_iterator &rhs) const {
+		    return (ctn != rhs.ctn) || (idx != rhs.idx);
+		}
+	};
+	ring_deque(): blocks(NULL), mapCap(0), head(0), sizeD(0), spare(NULL) {}
+	explicit ring_deque(const Allocator &a):
+	    alloc(a), blocks(NULL), mapCap(0), head(0), sizeD(0), spare(NULL) {}
+	ring_deque(const ring_deque &other):
+	    alloc(alloc_traits::select_on_container_copy_construction(other.alloc)),
+	    blocks(NULL), mapCap(0), head(0), sizeD(0), spare(NULL) {
+        try {
+            CopyFrom(other);
+        }
+        catch (...) {
+            FreeAll();
+            throw;
+        }
+	}
+	ring_deque(ring_deque &&other): alloc(std::move(other.alloc)) {
+        StealFrom(other);
+	}
+	~ring_deque() {
+        FreeAll();
+	}
+	ring_deque &operator=(const ring_deque &other) {
+        if (this == &other) return *this;
+        FreeAll();
+        if (alloc_traits::propagate_on_container_copy_assignment::value)
+            alloc = other.alloc;
+        CopyFrom(other);
+        return *this;
+	}
+	ring_deque &operator=(ring_deque &&other) {
+        if (this == &other) return *this;
+        FreeAll();
+        if (alloc_traits::propagate_on_container_move_assignment::value) {
+            alloc = std::move(other.alloc);
+            StealFrom(other);
+        }
+        else if (alloc == other.alloc) StealFrom(other);
+        else {
+            // blocks from a foreign allocator must be rebuilt with ours
+            CopyFrom(other);
+            other.clear();
+        }
+        return *this;
+	}
+	void swap(ring_deque &other) {
+        if (alloc_traits::propagate_on_container_swap::value)
+            std::swap(alloc, other.alloc);
+        std::swap(blocks, other.blocks);
+        std::swap(mapCap, other.mapCap);
+        std::swap(head, other.head);
+        std::swap(sizeD, other.sizeD);
+        std::swap(spare, other.spare);
+	}
+	allocator_type get_allocator() const {
+        return alloc;
+	}
+	T & at(const size_t &pos) {
+        if (pos >= sizeD) throw index_out_of_bound();
+        return *Slot(pos);
+	}
+	const T & at(const size_t &pos) const {
+        if (pos >= sizeD) throw index_out_of_bound();
+        return *Slot(pos);
+	}
+	T & operator[](const size_t &pos) {
+        if (pos >= sizeD) throw index_out_of_bound();
+        return *Slot(pos);
+	}
+	const T & operator[](const size_t &pos) const {
+        if (pos >= sizeD) throw index_out_of_bound();
+        return *Slot(pos);
+	}
+	const T & front() const {
+        if (sizeD == 0) throw container_is_empty();
+        return *Slot(0);
+	}
+	const T & back() const {
+        if (sizeD == 0) throw container_is_empty();
+        return *Slot(sizeD - 1);
+	}
+	iterator begin() {
+        return iterator(this, 0);
+	}
+	const_iterator cbegin() const {
+        return const_iterator(this, 0);
+	}
+	iterator end() {
+        return iterator(this, sizeD);
+	}
+	const_iterator cend() const {
+        return const_iterator(this, sizeD);
+	}
+	bool empty() const {
+        return sizeD == 0;
+	}
+	size_t size() const {
+        return sizeD;
+	}
+	void clear() {
+        while (sizeD) pop_back();
+	}
+	iterator insert(iterator pos, const T &value) {
+        if (pos.ctn != this || pos.idx > sizeD) throw invalid_iterator();
+        size_t k = pos.idx;
+        if (k < sizeD / 2) {
+            GrowFront();
+            MoveDown(1, k + 1);
+            try {
+                alloc_traits::construct(alloc, Slot(k), value);
+            }
+            catch (...) {
+                MoveUp(0, k);
+                DropFront();
+                throw;
+            }
+        }
+        else {
+            GrowBack();
+            MoveUp(k, sizeD - 1);
+            try {
+                alloc_traits::construct(alloc, Slot(k), value);
+            }
+            catch (...) {
+                MoveDown(k + 1, sizeD);
+                DropBack();
+                throw;
+            }
+        }
+        return iterator(this, k);
+	}
+	iterator erase(iterator pos) {
+        if (sizeD == 0) throw container_is_empty();
+        if (pos.ctn != this || pos.idx >= sizeD) throw invalid_iterator();
+        size_t k = pos.idx;
+        alloc_traits::destroy(alloc, Slot(k));
+        if (k < sizeD / 2) {
+            MoveUp(0, k);
+            DropFront();
+        }
+        else {
+            MoveDown(k + 1, sizeD);
+            DropBack();
+        }
+        return iterator(this, k);
+	}
+	void push_back(const T &value) {
+        T *p = GrowBack();
+        try {
+            alloc_traits::construct(alloc, p, value);
+        }
+        catch (...) {
+            DropBack();
+            throw;
+        }
+	}
+	void pop_back() {
+        if (sizeD == 0) throw container_is_empty();
+        alloc_traits::destroy(alloc, Slot(sizeD - 1));
+        DropBack();
+	}
+	void push_front(const T &value) {
+        T *p = GrowFront();
+        try {
+            alloc_traits::construct(alloc, p, value);
+        }
+        catch (...) {
+            DropFront();
+            throw;
+        }
+	}
+	void pop_front() {
+        if (sizeD == 0) throw container_is_empty();
+        alloc_traits::destroy(alloc, Slot(0));
+        DropFront();
+	}
+};
+
+}
+
+#endif
@@ -0,0 +1,424 @@
+#ifndef SJTU_SMALL_VECTOR_HPP
+#define SJTU_SMALL_VECTOR_HPP
+
+#include "exceptions.hpp"
+#include "utility.hpp"
+
+#include <cstddef>
+#include <memory>
+#include <type_traits>
+#include <utility>
+
+namespace sjtu {
+
+/**
+ * A vector that keeps its first N elements inside the object itself and
+ * only goes to the heap once it grows past N.  Same interface, iterators
+ * and exceptions as sjtu::vector.
+ */
+template<typename T, size_t N, class Allocator = std::allocator<T>>
+class small_vector {
+    static_assert(N > 0, "small_vector needs room for at least one element");
+public:
+    typedef Allocator allocator_type;
+private:
+    typedef std::allocator_traits<Allocator> alloc_traits;
+
+    Allocator alloc;
+    typename std::aligned_storage<sizeof(T), alignof(T)>::type inlineBuf[N];
+    T *storage;
+    size_t maxSize, nowSize;
+
+    T *inlineStorage() {
+        return reinterpret_cast<T*>(inlineBuf);
+    }
+    bool isInline() const {
+        return storage == reinterpret_cast<const T*>(inlineBuf);
+    }
+    void destroyAll() {
+        for (size_t i = 0; i < nowSize; ++i)
+            alloc_traits::destroy(alloc, storage + i);
+        if (!isInline()) alloc_traits::deallocate(alloc, storage, maxSize);
+        storage = inlineStorage();
+        nowSize = 0;
+        maxSize = N;
+    }
+    void copyFrom(const small_vector &other) {
+        if (other.nowSize > N) {
+            storage = alloc_traits::allocate(alloc, other.nowSize);
+            maxSize = other.nowSize;
+        }
+        try {
+            for (; nowSize < other.nowSize; ++nowSize)
+                alloc_traits::construct(alloc, storage + nowSize, other.storage[nowSize]);
+        }
+        catch (...) {
+            destroyAll();
+            throw;
+        }
+    }
+    // take other's elements, leaving it empty; heap buffers change hands
+    // only when canSteal, otherwise elements are relocated one by one
+    void moveFrom(small_vector &other, bool canSteal) {
+        if (!other.isInline() && canSteal) {
+            storage = other.storage;
+            maxSize = other.maxSize;
+        }
+        else {
+            if (other.nowSize > N) {
+                storage = alloc_traits::allocate(alloc, other.nowSize);
+                maxSize = other.nowSize;
+            }
+            try {
+                relocate(alloc, storage, other.storage, other.nowSize);
+            }
+            catch (...) {
+                if (!isInline()) alloc_traits::deallocate(alloc, storage, maxSize);
+                storage = inlineStorage();
+                maxSize = N;
+                throw;
+            }
+            if (!other.isInline())
+                alloc_traits::deallocate(other.alloc, other.storage, other.maxSize);
+        }
+        nowSize = other.nowSize;
+        other.storage = other.inlineStorage();
+        other.nowSize = 0;
+        other.maxSize = N;
+    }
+    // both inline: swap the elements both have, relocate the rest across
+    void swapInline(small_vector &other) {
+        small_vector &big = nowSize >= other.nowSize ? *this : other;
+        small_vector &little = nowSize >= other.nowSize ? other : *this;
+        size_t common = little.nowSize;
+        using std::swap;
+        for (size_t i = 0; i < common; ++i)
+            swap(storage[i], other.storage[i]);
+        relocate(little.alloc, little.storage + common, big.storage + common, big.nowSize - common);
+    }
+    // we are on the heap and other inline: its elements move into our
+    // inline buffer and our heap buffer goes to it
+    void tradeHeap(small_vector &other) {
+        relocate(alloc, inlineStorage(), other.storage, other.nowSize);
+        other.storage = storage;
+        storage = inlineStorage();
+    }
+    // as in vector: a failed shift leaves only [0, ind)
+    void insertAt(size_t ind, const T &value) {
+        temp_value<Allocator, T> tmp(alloc, value);
+        if (nowSize == maxSize) doubleSpace();
+        try {
+            shift_in(alloc, storage + ind, nowSize - ind, tmp);
+        }
+        catch (...) {
+            nowSize = ind;
+            throw;
+        }
+        ++nowSize;
+    }
+    void eraseAt(size_t ind) {
+        alloc_traits::destroy(alloc, storage + ind);
+        try {
+            shift(alloc, storage + ind, storage + ind + 1, nowSize - ind - 1);
+        }
+        catch (...) {
+            nowSize = ind;
+            throw;
+        }
+        --nowSize;
+    }
+    template<class V>
+    void growAndAppend(V &&value) {
+        temp_value<Allocator, T> tmp(alloc, std::forward<V>(value));
+        doubleSpace();
+        tmp.relocate_to(storage + nowSize);
+    }
+    void doubleSpace() {
+        size_t newMaxSize = maxSize << 1;
+        T *tmp = alloc_traits::allocate(alloc, newMaxSize);
+        try {
+            relocate(alloc, tmp, storage, nowSize);
+        }
+        catch (...) {
+            alloc_traits::deallocate(alloc, tmp, newMaxSize);
+            throw;
+        }
+        if (!isInline()) alloc_traits::deallocate(alloc, storage, maxSize);
+        storage = tmp;
+        maxSize = newMaxSize;
+    }
+public:
+	class const_iterator;
+	class iterator {
+        friend class small_vector;
+	private:
+        small_vector *ctn;
+        int idx;
+	public:
+        iterator(small_vector *p, int x): ctn(p), idx(x) {}
+		iterator operator+(const int &n) const {
+			return iterator(ctn, idx + n);
+		}
+		iterator operator-(const int &n) const {
+			return iterator(ctn, idx - n);
+		}
+		int operator-(const iterator &rhs) const {
+            if (ctn != rhs.ctn) throw invalid_iterator();
+            return idx - rhs.idx;
+		}
+		iterator operator+=(const int &n) {
+            idx += n;
+            return *this;
+		}
+		iterator operator-=(const int &n) {
+			idx -= n;
+            return *this;
+		}
+		iterator operator++(int) {
+            iterator tmp = *this;
+            ++idx;
+            return tmp;
+		}
+		iterator& operator++() {
+            ++idx;
+            return *this;
+		}
+		iterator operator--(int) {
+            iterator tmp = *this;
+            --idx;
+            return tmp;
+		}
+		iterator& operator--() {
+            --idx;
+            return *this;
+		}
+        T& operator*() const{
+            return ctn -> storage[idx];
+		}
+		bool operator==(const iterator &rhs) const {
+            return (ctn == rhs.ctn) && (idx == rhs.idx);
+		}
+		bool operator==(const const_iterator &rhs) const {
+            return (ctn == rhs.ctn) && (idx == rhs.idx);
+		}
+		bool operator!=(const iterator &rhs) const {
+            return (ctn != rhs.ctn) || (idx != rhs.idx);
+        }
+		bool operator!=(const const_iterator &rhs) const {
+            return (ctn != rhs.ctn) || (idx != rhs.idx);
+		}
+	};
+	class const_iterator {
+        friend class small_vector;
+    private:
+        const small_vector *ctn;
+        int idx;
+	public:
+        const_iterator(const small_vector *p, int x): ctn(p), idx(x) {}
+		const_iterator operator+(const int &n) const {
+			return const_iterator(ctn, idx + n);
+		}
+		const_iterator operator-(const int &n) const {
+			return const_iterator(ctn, idx - n);
+		}
+		int operator-(const const_iterator &rhs) const {
+            if (ctn != rhs.ctn) throw invalid_iterator();
+            return idx - rhs.idx;
+		}
+		const_iterator operator+=(const int &n) {
+            idx += n;
+            return *this;
+		}
+		const_iterator operator-=(const int &n) {
+			idx -= n;
+            return *this;
+		}
+		const_iterator operator++(int) {
+            const_iterator tmp = *this;
+            ++idx;
+            return tmp;
+		}
+		const_iterator& operator++() {
+            ++idx;
+            return *this;
+		}
+		const_iterator operator--(int) {
+            const_iterator tmp = *this;
+            --idx;
+            return tmp;
+		}
+		const_iterator& operator--() {
+            --idx;
+            return *this;
+		}
+        const T& operator*() const{
+            return ctn -> storage[idx];
+		}
+		bool operator==(const iterator &rhs) const {
+            return (ctn == rhs.ctn) && (idx == rhs.idx);
+		}
+		bool operator==(const const_iterator &rhs) const {
+            return (ctn == rhs.ctn) && (idx == rhs.idx);
+		}
+		bool operator!=(const iterator &rhs) const {
+            return (ctn != rhs.ctn) || (idx != rhs.idx);
+        }
+		bool operator!=(const const_iterator &rhs) const {
+            return (ctn != rhs.ctn) || (idx != rhs.idx);
+		}
+	};
+	// nothing is allocated until the first element arrives
+	small_vector(): storage(inlineStorage()), maxSize(N), nowSize(0) {}
+	explicit small_vector(const Allocator &a):
+	    alloc(a), storage(inlineStorage()), maxSize(N), nowSize(0) {}
+	small_vector(const small_vector &other):
+	    alloc(alloc_traits::select_on_container_copy_construction(other.alloc)),
+	    storage(inlineStorage()), maxSize(N), nowSize(0) {
+        copyFrom(other);
+	}
+	small_vector(small_vector &&other):
+	    alloc(std::move(other.alloc)), storage(inlineStorage()), maxSize(N), nowSize(0) {
+        moveFrom(other, true);
+	}
+	~small_vector() {
+        destroyAll();
+	}
+	small_vector &operator=(const small_vector &other) {
+        if (this == &other) return *this;
+        destroyAll();
+        if (alloc_traits::propagate_on_container_copy_assignment::value)
+            alloc = other.alloc;
+        copyFrom(other);
+        return *this;
+	}
+	small_vector &operator=(small_vector &&other) {
+        if (this == &other) return *this;
+        destroyAll();
+        if (alloc_traits::propagate_on_container_move_assignment::value) {
+            alloc = std::move(other.alloc);
+            moveFrom(other, true);
+        }
+        else moveFrom(other, alloc == other.alloc);
+        return *this;
+	}
+	// heap buffers change hands by pointer; only inline elements are
+	// swapped or relocated one by one
+	void swap(small_vector &other) {
+        if (this == &other) return;
+        if (alloc_traits::propagate_on_container_swap::value)
+            std::swap(alloc, other.alloc);
+        if (!isInline() && !other.isInline()) std::swap(storage, other.storage);
+        else if (isInline() && other.isInline()) swapInline(other);
+        else if (isInline()) other.tradeHeap(*this);
+        else tradeHeap(other);
+        std::swap(nowSize, other.nowSize);
+        std::swap(maxSize, other.maxSize);
+	}
+	allocator_type get_allocator() const {
+        return alloc;
+	}
+	T & at(const size_t &pos) {
+        if (pos >= nowSize) throw index_out_of_bound();
+        return storage[pos];
+	}
+	const T & at(const size_t &pos) const {
+        if (pos >= nowSize) throw index_out_of_bound();
+        return storage[pos];
+    }
+	T & operator[](const size_t &pos) {
+        if (pos >= nowSize) throw index_out_of_bound();
+        return storage[pos];
+	}
+	const T & operator[](const size_t &pos) const {
+        if (pos >= nowSize) throw index_out_of_bound();
+        return storage[pos];
+	}
+	const T & front() const {
+        if (nowSize == 0) throw container_is_empty();
+        return storage[0];
+	}
+	const T & back() const {
+        if (nowSize == 0) throw container_is_empty();
+        return storage[nowSize - 1];
+	}
+	iterator begin() {
+        return iterator(this, 0);
+	}
+	const_iterator cbegin() const {
+        return const_iterator(this, 0);
+	}
+	iterator end() {
+        return iterator(this, nowSize);
+	}
+	const_iterator cend() const {
+        return const_iterator(this, nowSize);
+	}
+	bool empty() const {
+        return nowSize == 0;
+	}
+	size_t size() const {
+        return nowSize;
+	}
+	size_t capacity() const {
+        return maxSize;
+	}
+	void reserve(const size_t &n) {
+        if (n <= maxSize) return;
+        T *tmp = alloc_traits::allocate(alloc, n);
+        try {
+            relocate(alloc, tmp, storage, nowSize);
+        }
+        catch (...) {
+            alloc_traits::deallocate(alloc, tmp, n);
+            throw;
+        }
+        if (!isInline()) alloc_traits::deallocate(alloc, storage, maxSize);
+        storage = tmp;
+        maxSize = n;
+	}
+	// true while the elements still live inside the object
+	bool is_inline() const {
+        return isInline();
+	}
+	void clear() {
+        destroyAll();
+	}
+	iterator insert(iterator pos, const T &value) {
+        insertAt(pos.idx, value);
+        return iterator(this, pos.idx);
+	}
+	iterator insert(const size_t &ind, const T &value) {
+        if (ind > nowSize) throw index_out_of_bound();
+        insertAt(ind, value);
+        return iterator(this, ind);
+	}
+	iterator erase(iterator pos) {
+        eraseAt(pos.idx);
+        return pos;
+	}
+	iterator erase(const size_t &ind) {
+        if (ind >= nowSize) throw index_out_of_bound();
+        eraseAt(ind);
+        return iterator(this, ind);
+	}
+	void push_back(const T &value) {
+        if (nowSize == maxSize) growAndAppend(value);
+        else alloc_traits::construct(alloc, storage + nowSize, value);
+        ++nowSize;
+	}
+	void push_back(T &&value) {
+        if (nowSize == maxSize) growAndAppend(std::move(value));
+        else alloc_traits::construct(alloc, storage + nowSize, std::move(value));
+        ++nowSize;
+	}
+	void pop_back() {
+        if (nowSize == 0) throw container_is_empty();
+        --nowSize;
+        alloc_traits::destroy(alloc, storage + nowSize);
+	}
+};
+
+
+}
+
+#endif
@@ -1,6 +1,10 @@
 #ifndef SJTU_UTILITY_HPP
 #define SJTU_UTILITY_HPP
 
+#include <cstring>
+#include <memory>
+#include <tuple>
+#include <type_traits>
 #include <utility>
 
 namespace sjtu {
@@ -15,13 +19,167 @@ public:
 	pair(pair &&other) = default;
 	pair(const T1 &x, const T2 &y) : first(x), second(y) {}
 	template<class U1, class U2>
-	pair(U1 &&x, U2 &&y) : first(x), second(y) {}
+	pair(U1 &&x, U2 &&y) : first(std::forward<U1>(x)), second(std::forward<U2>(y)) {}
 	template<class U1, class U2>
 	pair(const pair<U1, U2> &other) : first(other.first), second(other.second) {}
 	template<class U1, class U2>
-	pair(pair<U1, U2> &&other) : first(other.first), second(other.second) {}
+	pair(pair<U1, U2> &&other) : first(std::forward<U1>(other.first)), second(std::forward<U2>(other.second)) {}
+	// first and second built in place from the two argument tuples
+	template<class... Args1, class... Args2>
+	pair(std::piecewise_construct_t, std::tuple<Args1...> a1, std::tuple<Args2...> a2) :
+		pair(a1, a2, std::index_sequence_for<Args1...>(), std::index_sequence_for<Args2...>()) {}
+private:
+	template<class Tuple1, class Tuple2, size_t... I1, size_t... I2>
+	pair(Tuple1 &a1, Tuple2 &a2, std::index_sequence<I1...>, std::index_sequence<I2...>) :
+		first(std::get<I1>(std::move(a1))...), second(std::get<I2>(std::move(a2))...) {}
 };
 
+template<class T>
+inline T gmax(const T &a, const T &b) {
+    return a > b ? a : b;
+}
+template<class T>
+inline T gmin(const T &a, const T &b) {
+    return a < b ? a : b;
+}
+
+/**
+ * Tells the containers that a T can be moved to a new address by copying
+ * its bytes and forgetting the old copy, so they may use memcpy/memmove
+ * instead of constructing and destroying element by element.
+ * True for trivially copyable types; specialize it for your own types
+ * that own their resources through plain pointers (e.g. a big integer
+ * holding an int* buffer):
+ *     namespace sjtu {
+ *     template<> struct is_trivially_relocatable<Bint> : std::true_type {};
+ *     }
+ */
+template<class T>
+struct is_trivially_relocatable : std::is_trivially_copyable<T> {};
+
+// true when deallocating through alloc does nothing because its memory is
+// handed back all at once elsewhere (see monotonic_arena); containers then
+// skip walking their nodes on destruction if nothing needs destroying
+template<class Alloc>
+bool skips_deallocate(const Alloc &) {
+    return false;
+}
+
+// move n elements from src into raw memory at dst, leaving src raw;
+// relocatable types are moved as bytes, skipping alloc's construct/destroy
+template<class Alloc, class T>
+void relocate(Alloc &, T *dst, T *src, int n, std::true_type) {
+    if (n > 0) std::memcpy((void*)dst, (const void*)src, n * sizeof(T));
+}
+template<class Alloc, class T>
+void relocate(Alloc &alloc, T *dst, T *src, int n, std::false_type) {
+    typedef std::allocator_traits<Alloc> traits;
+    int i = 0;
+    try {
+        for (; i < n; ++i)
+            traits::construct(alloc, dst + i, std::move_if_noexcept(src[i]));
+    }
+    catch (...) {
+        for (int j = 0; j < i; ++j)
+            traits::destroy(alloc, dst + j);
+        throw;
+    }
+    for (i = 0; i < n; ++i)
+        traits::destroy(alloc, src + i);
+}
+template<class Alloc, class T>
+void relocate(Alloc &alloc, T *dst, T *src, int n) {
+    relocate(alloc, dst, src, n, is_trivially_relocatable<T>());
+}
+
+// like relocate, but the two ranges may overlap (used to open or close
+// a gap inside one buffer); the slots left behind are raw.  If moving an
+// element throws, every element of both ranges is destroyed before the
+// exception goes on, so the whole span is raw and the caller only has to
+// forget it
+template<class Alloc, class T>
+void shift(Alloc &, T *dst, T *src, int n, std::true_type) {
+    if (n > 0) std::memmove((void*)dst, (const void*)src, n * sizeof(T));
+}
+template<class Alloc, class T>
+void shift(Alloc &alloc, T *dst, T *src, int n, std::false_type) {
+    typedef std::allocator_traits<Alloc> traits;
+    int moved = 0;
+    try {
+        if (dst > src) {
+            for (int i = n - 1; i >= 0; --i, ++moved) {
+                traits::construct(alloc, dst + i, std::move_if_noexcept(src[i]));
+                traits::destroy(alloc, src + i);
+            }
+        }
+        else {
+            for (int i = 0; i < n; ++i, ++moved) {
+                traits::construct(alloc, dst + i, std::move_if_noexcept(src[i]));
+                traits::destroy(alloc, src + i);
+            }
+        }
+    }
+    catch (...) {
+        if (dst > src) {
+            for (int i = 0; i < n - moved; ++i) traits::destroy(alloc, src + i);
+            for (int i = n - moved; i < n; ++i) traits::destroy(alloc, dst + i);
+        }
+        else {
+            for (int i = 0; i < moved; ++i) traits::destroy(alloc, dst + i);
+            for (int i = moved; i < n; ++i) traits::destroy(alloc, src + i);
+        }
+        throw;
+    }
+}
+template<class Alloc, class T>
+void shift(Alloc &alloc, T *dst, T *src, int n) {
+    shift(alloc, dst, src, n, is_trivially_relocatable<T>());
+}
+
+// a T built through alloc outside any buffer, e.g. a copy of an element
+// about to be inserted into the container it came from; destroyed with
+// the holder unless it was relocated away
+template<class Alloc, class T>
+class temp_value {
+    Alloc &alloc;
+    typename std::aligned_storage<sizeof(T), alignof(T)>::type buf;
+    bool live;
+public:
+    template<class... Args>
+    temp_value(Alloc &a, Args&&... args): alloc(a), live(false) {
+        std::allocator_traits<Alloc>::construct(alloc, get(), std::forward<Args>(args)...);
+        live = true;
+    }
+    temp_value(const temp_value &) = delete;
+    temp_value &operator=(const temp_value &) = delete;
+    ~temp_value() {
+        if (live) std::allocator_traits<Alloc>::destroy(alloc, get());
+    }
+    T *get() {
+        return reinterpret_cast<T*>(&buf);
+    }
+    // move the value into raw memory at dst; the holder is empty after
+    void relocate_to(T *dst) {
+        relocate(alloc, dst, get(), 1);
+        live = false;
+    }
+};
+
+// open a slot at pos by shifting [pos, pos + n) up by one (pos + n must be
+// raw) and move tmp into it.  If that throws, [pos, pos + n] is left raw
+template<class Alloc, class T>
+void shift_in(Alloc &alloc, T *pos, int n, temp_value<Alloc, T> &tmp) {
+    shift(alloc, pos + 1, pos, n);
+    try {
+        tmp.relocate_to(pos);
+    }
+    catch (...) {
+        for (int i = 1; i <= n; ++i)
+            std::allocator_traits<Alloc>::destroy(alloc, pos + i);
+        throw;
+    }
+}
+
 }
 
 #endif
@@ -2,36 +2,113 @@
 #define SJTU_VECTOR_HPP
 
 #include "exceptions.hpp"
+#include "utility.hpp"
 
 #include <climits>
 #include <cstddef>
+#include <memory>
+#include <type_traits>
+#include <utility>
 
 namespace sjtu {
 
-template<typename T>
+template<typename T, class Allocator = std::allocator<T>>
 class vector {
+public:
+    typedef Allocator allocator_type;
 private:
+    typedef std::allocator_traits<Allocator> alloc_traits;
+
+    Allocator alloc;
     T *storage;
     int maxSize, nowSize;
 
+    // a failed shift leaves the tail raw: only [0, ind) survives
+    void insertAt(int ind, const T &value) {
+        // value may be one of our own elements, which growing or shifting
+        // would move, so the copy is taken first
+        temp_value<Allocator, T> tmp(alloc, value);
+        if (nowSize == maxSize) doubleSpace();
+        try {
+            shift_in(alloc, storage + ind, nowSize - ind, tmp);
+        }
+        catch (...) {
+            nowSize = ind;
+            throw;
+        }
+        ++nowSize;
+    }
+    void eraseAt(int ind) {
+        alloc_traits::destroy(alloc, storage + ind);
+        try {
+            shift(alloc, storage + ind, storage + ind + 1, nowSize - ind - 1);
+        }
+        catch (...) {
+            nowSize = ind;
+            throw;
+        }
+        --nowSize;
+    }
     void doubleSpace() {
-        if (maxSize == 0) maxSize = 10;
-        maxSize <<= 1;
-        T *tmp = storage;
-        storage = (T*)::operator new(maxSize * sizeof(T));
+        int newMaxSize = maxSize == 0 ? 10 : maxSize << 1;
+        T *tmp = alloc_traits::allocate(alloc, newMaxSize);
+        try {
+            relocate(alloc, tmp, storage, nowSize);
+        }
+        catch (...) {
+            alloc_traits::deallocate(alloc, tmp, newMaxSize);
+            throw;
+        }
+        if (storage) alloc_traits::deallocate(alloc, storage, maxSize);
+        storage = tmp;
+        maxSize = newMaxSize;
+    }
+    // value may be one of our own elements: build it before growing
+    template<class V>
+    void growAndAppend(V &&value) {
+        temp_value<Allocator, T> tmp(alloc, std::forward<V>(value));
+        doubleSpace();
+        tmp.relocate_to(storage + nowSize);
+    }
+    void destroyAll() {
         for (int i = 0; i < nowSize; ++i)
-            storage[i] = tmp[i];
-        ::operator delete(tmp);
+            alloc_traits::destroy(alloc, storage + i);
+        if (storage) alloc_traits::deallocate(alloc, storage, maxSize);
+        storage = NULL;
+        nowSize = maxSize = 0;
+    }
+    // fill an empty vector with copies of other[0, n), reserving cap slots
+    template<class OVector>
+    void copyFrom(const OVector &other, int n, int cap) {
+        if (cap == 0) return;
+        storage = alloc_traits::allocate(alloc, cap);
+        maxSize = cap;
+        try {
+            for (; nowSize < n; ++nowSize)
+                alloc_traits::construct(alloc, storage + nowSize, other[nowSize]);
+        }
+        catch (...) {
+            destroyAll();
+            throw;
+        }
+    }
+    // take other's buffer, leaving it empty; allocators must be compatible
+    void stealFrom(vector &other) {
+        storage = other.storage;
+        nowSize = other.nowSize;
+        maxSize = other.maxSize;
+        other.storage = NULL;
+        other.nowSize = other.maxSize = 0;
     }
 public:
 	class const_iterator;
 	class iterator {
-        friend class vector<T>;
+        friend class vector;
 	private:
-        vector<T> *ctn;
+        vector *ctn;
         int idx;
 	public:
-        iterator(vector<T> *p, int x): ctn(p), idx(x) {}
+        iterator(vector *p, int x): ctn(p), idx(x) {}
 		iterator operator+(const int &n) const {
 			return iterator(ctn, idx + n);
 		}
@@ -85,12 +162,12 @@ public:
 		}
 	};
 	class const_iterator {
-        friend class vector<T>;
+        friend class vector;
     private:
-        const vector<T> *ctn;
+        const vector *ctn;
         int idx;
 	public:
-        const_iterator(const vector<T> *p, int x): ctn(p), idx(x) {}
+        const_iterator(const vector *p, int x): ctn(p), idx(x) {}
 		const_iterator operator+(const int &n) const {
 			return const_iterator(ctn, idx + n);
 		}
@@ -143,35 +220,72 @@ public:
             return (ctn != rhs.ctn) || (idx != rhs.idx);
 		}
 	};
-	vector(): nowSize(0), maxSize(10) {
-        storage = (T*)::operator new(maxSize * sizeof(T));
+	// nothing is allocated until the first element arrives
+	vector(): storage(NULL), nowSize(0), maxSize(0) {}
+	explicit vector(const Allocator &a): alloc(a), storage(NULL), nowSize(0), maxSize(0) {}
+	vector(const vector &other):
+	    alloc(alloc_traits::select_on_container_copy_construction(other.alloc)),
+	    storage(NULL), nowSize(0), maxSize(0) {
+        copyFrom(other, other.nowSize, other.maxSize);
 	}
-	vector(const vector &other): nowSize(other.nowSize), maxSize(other.maxSize) {
-        storage = (T*)::operator new(maxSize * sizeof(T));
-        for (int i = 0; i < nowSize; ++i)
-            storage[i] = other.storage[i];
+	vector(vector &&other): alloc(std::move(other.alloc)) {
+        stealFrom(other);
 	}
-    template<class OVector>
-    vector(const OVector &other): nowSize(other.size()), maxSize(other.capacity()) {
-        storage = (T*)::operator new(maxSize * sizeof(T));
-        for (int i = 0; i < nowSize; ++i)
-            storage[i] = other[i];
+    // anything that converts to the allocator is an allocator, not a vector
+    template<class OVector, class = typename std::enable_if<
+        !std::is_convertible<const OVector&, Allocator>::value>::type>
+    vector(const OVector &other): storage(NULL), nowSize(0), maxSize(0) {
+        copyFrom(other, other.size(), other.capacity() > other.size() ? other.capacity() : other.size());
     }
 	~vector() {
-	    for (int i = 0; i < nowSize; ++i)
-            storage[i].~T();
-        if (storage) ::operator delete(storage);
+        destroyAll();
 	}
 	vector &operator=(const vector &other) {
         if (this == &other) return *this;
-        if (storage) ::operator delete(storage);
-        nowSize = other.nowSize;
-        maxSize = other.maxSize;
-        storage = (T*)::operator new(maxSize * sizeof(T));
-        for (int i = 0; i < nowSize; ++i)
-            storage[i] = other.storage[i];
+        destroyAll();
+        if (alloc_traits::propagate_on_container_copy_assignment::value)
+            alloc = other.alloc;
+        copyFrom(other, other.nowSize, other.maxSize);
+        return *this;
+	}
+	vector &operator=(vector &&other) {
+        if (this == &other) return *this;
+        destroyAll();
+        if (alloc_traits::propagate_on_container_move_assignment::value) {
+            alloc = std::move(other.alloc);
+            stealFrom(other);
+        }
+        else if (alloc == other.alloc) stealFrom(other);
+        else {
+            // our allocator cannot free other's buffer: move element-wise
+            if (other.maxSize == 0) return *this;
+            T *tmp = alloc_traits::allocate(alloc, other.maxSize);
+            try {
+                relocate(alloc, tmp, other.storage, other.nowSize);
+            }
+            catch (...) {
+                alloc_traits::deallocate(alloc, tmp, other.maxSize);
+                throw;
+            }
+            storage = tmp;
+            nowSize = other.nowSize;
+            maxSize = other.maxSize;
+            alloc_traits::deallocate(other.alloc, other.storage, other.maxSize);
+            other.storage = NULL;
+            other.nowSize = other.maxSize = 0;
+        }
         return *this;
 	}
+	void swap(vector &other) {
+        if (alloc_traits::propagate_on_container_swap::value)
+            std::swap(alloc, other.alloc);
+        std::swap(storage, other.storage);
+        std::swap(nowSize, other.nowSize);
+        std::swap(maxSize, other.maxSize);
+	}
+	allocator_type get_allocator() const {
+        return alloc;
+	}
 	T & at(const size_t &pos) {
         if (pos < 0 || pos >= nowSize) throw index_out_of_bound();
         return storage[pos];
@@ -218,54 +332,55 @@ public:
         return maxSize;
 	}
 	void clear() {
-        for (int i = 0; i < nowSize; ++i)
-            storage[i].~T();
-        if (storage) ::operator delete(storage);
-        nowSize = 0;
-        maxSize = 10;
-        storage = (T*)::operator new(maxSize * sizeof(T));
+        destroyAll();
+	}
+	// make room for n elements without reallocating on the way there
+	void reserve(const size_t &n) {
+        if (n <= maxSize) return;
+        T *tmp = alloc_traits::allocate(alloc, n);
+        try {
+            relocate(alloc, tmp, storage, nowSize);
+        }
+        catch (...) {
+            alloc_traits::deallocate(alloc, tmp, n);
+            throw;
+        }
+        if (storage) alloc_traits::deallocate(alloc, storage, maxSize);
+        storage = tmp;
+        maxSize = n;
 	}
 	iterator insert(iterator pos, const T &value) {
-        if (nowSize == maxSize) doubleSpace();
-        for (int i = nowSize; i > pos.idx; --i)
-            storage[i] = storage[i - 1];
-        ++nowSize;
-        ::new (&storage[pos.idx]) T(value);
+        insertAt(pos.idx, value);
         return iterator(this, pos.idx);
 	}
 	iterator insert(const size_t &ind, const T &value) {
         if (ind > nowSize) throw index_out_of_bound();
-        if (nowSize == maxSize) doubleSpace();
-        for (int i = nowSize; i > ind; --i)
-            storage[i] = storage[i - 1];
-        ++nowSize;
-        ::new (&storage[ind]) T(value);
+        insertAt(ind, value);
         return iterator(this, ind);
 	}
 	iterator erase(iterator pos) {
-        --nowSize;
-        for (int i = pos.idx; i < nowSize; ++i)
-            storage[i] = storage[i + 1];
-        storage[nowSize].~T();
+        eraseAt(pos.idx);
         return pos;
 	}
 	iterator erase(const size_t &ind) {
         if (ind >= nowSize) throw index_out_of_bound();
-        --nowSize;
-        for (int i = ind; i < nowSize; ++i)
-            storage[i] = storage[i + 1];
-        storage[nowSize].~T();
+        eraseAt(ind);
         return iterator(this, ind);
 	}
 	void push_back(const T &value) {
-        if (nowSize == maxSize) doubleSpace();
-        ::new (&storage[nowSize]) T(value);
+        if (nowSize == maxSize) growAndAppend(value);
+        else alloc_traits::construct(alloc, storage + nowSize, value);
+        ++nowSize;
+	}
+	void push_back(T &&value) {
+        if (nowSize == maxSize) growAndAppend(std::move(value));
+        else alloc_traits::construct(alloc, storage + nowSize, std::move(value));
         ++nowSize;
 	}
 	void pop_back() {
         if (nowSize == 0) throw container_is_empty();
         --nowSize;
-        storage[nowSize].~T();
+        alloc_traits::destroy(alloc, storage + nowSize);
 	}
 };
 
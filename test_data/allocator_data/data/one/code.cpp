@@ -0,0 +1,152 @@
+#include "vector.hpp"
+#include "deque.hpp"
+#include "ring_deque.hpp"
+#include "map.hpp"
+
+#include <iostream>
+#include <string>
+#include <type_traits>
+
+// live allocations per allocator id; a deallocation through an allocator
+// other than the one that allocated drives a count negative
+int live[1000];
+bool mismatch = false;
+
+template<class T, class Propagate>
+class TaggedAllocator {
+public:
+	typedef T value_type;
+	typedef Propagate propagate_on_container_copy_assignment;
+	typedef Propagate propagate_on_container_move_assignment;
+	typedef Propagate propagate_on_container_swap;
+	int id;
+
+	explicit TaggedAllocator(int id = 0): id(id) {}
+	template<class U>
+	TaggedAllocator(const TaggedAllocator<U, Propagate> &other): id(other.id) {}
+	T *allocate(size_t n) {
+		++live[id];
+		return static_cast<T*>(::operator new(n * sizeof(T)));
+	}
+	void deallocate(T *p, size_t) {
+		if (--live[id] < 0) mismatch = true;
+		::operator delete(p);
+	}
+	// copies of a non-propagating container start over with id + 100
+	TaggedAllocator select_on_container_copy_construction() const {
+		return TaggedAllocator(Propagate::value ? id : id + 100);
+	}
+	template<class U>
+	bool operator==(const TaggedAllocator<U, Propagate> &other) const {
+		return id == other.id;
+	}
+	template<class U>
+	bool operator!=(const TaggedAllocator<U, Propagate> &other) const {
+		return id != other.id;
+	}
+};
+
+int LiveTotal()
+{
+	int ret = 0;
+	for (int i = 0; i < 1000; ++i) ret += live[i];
+	return ret;
+}
+
+template<class Seq>
+void Fill(Seq &s, int n)
+{
+	for (int i = 0; i < n; ++i) s.push_back(std::to_string(i));
+}
+template<class Seq>
+std::string Dump(const Seq &s)
+{
+	std::string ret;
+	for (size_t i = 0; i < s.size(); ++i) ret += s[i] + " ";
+	return ret;
+}
+template<class Key, class T, class A>
+std::string Dump(const sjtu::map<Key, T, std::less<Key>, A> &m)
+{
+	std::string ret;
+	for (typename sjtu::map<Key, T, std::less<Key>, A>::const_iterator it = m.cbegin(); it != m.cend(); ++it) {
+		ret += std::to_string(it->first) + ":" + it->second + " ";
+	}
+	return ret;
+}
+template<class Key, class T, class A>
+void Fill(sjtu::map<Key, T, std::less<Key>, A> &m, int n)
+{
+	for (int i = 0; i < n; ++i) m[i] = std::to_string(i * i);
+}
+
+template<class C, class A>
+void TestPropagating(const char *name)
+{
+	std::cout << "Testing " << name << " with a propagating allocator..." << std::endl;
+	{
+		C a(A(1)), b(A(2));
+		Fill(a, 5);
+		Fill(b, 3);
+		std::cout << a.get_allocator().id << " " << b.get_allocator().id << std::endl;
+		C c(a);
+		std::cout << c.get_allocator().id << " " << Dump(c) << std::endl;
+		b = a;
+		std::cout << b.get_allocator().id << " " << Dump(b) << std::endl;
+		C d(A(3));
+		Fill(d, 2);
+		d = std::move(c);
+		std::cout << d.get_allocator().id << " " << Dump(d) << std::endl;
+		C e(std::move(d));
+		std::cout << e.get_allocator().id << " " << Dump(e) << std::endl;
+		C f(A(4));
+		Fill(f, 1);
+		e.swap(f);
+		std::cout << e.get_allocator().id << " " << f.get_allocator().id << " " << Dump(e) << "| " << Dump(f) << std::endl;
+	}
+	std::cout << LiveTotal() << " " << mismatch << std::endl;
+}
+
+template<class C, class A>
+void TestNonPropagating(const char *name)
+{
+	std::cout << "Testing " << name << " with a non-propagating allocator..." << std::endl;
+	{
+		C a(A(1)), b(A(2));
+		Fill(a, 5);
+		Fill(b, 3);
+		C c(a);
+		std::cout << c.get_allocator().id << " " << Dump(c) << std::endl;
+		b = a;
+		std::cout << b.get_allocator().id << " " << Dump(b) << std::endl;
+		// unequal allocators: the elements are moved over one by one
+		C d(A(3));
+		Fill(d, 2);
+		d = std::move(c);
+		std::cout << d.get_allocator().id << " " << Dump(d) << std::endl;
+		C e(std::move(d));
+		std::cout << e.get_allocator().id << " " << Dump(e) << std::endl;
+		C f(A(3));
+		Fill(f, 1);
+		e.swap(f);
+		std::cout << e.get_allocator().id << " " << f.get_allocator().id << " " << Dump(e) << "| " << Dump(f) << std::endl;
+	}
+	std::cout << LiveTotal() << " " << mismatch << std::endl;
+}
+
+int main()
+{
+	typedef TaggedAllocator<std::string, std::true_type> PropString;
+	typedef TaggedAllocator<std::string, std::false_type> FixedString;
+	typedef TaggedAllocator<sjtu::pair<const int, std::string>, std::true_type> PropPair;
+	typedef TaggedAllocator<sjtu::pair<const int, std::string>, std::false_type> FixedPair;
+	TestPropagating<sjtu::vector<std::string, PropString>, PropString>("vector");
+	TestNonPropagating<sjtu::vector<std::string, FixedString>, FixedString>("vector");
+	TestPropagating<sjtu::deque<std::string, PropString>, PropString>("deque");
+	TestNonPropagating<sjtu::deque<std::string, FixedString>, FixedString>("deque");
+	TestPropagating<sjtu::ring_deque<std::string, PropString>, PropString>("ring_deque");
+	TestNonPropagating<sjtu::ring_deque<std::string, FixedString>, FixedString>("ring_deque");
+	TestPropagating<sjtu::map<int, std::string, std::less<int>, PropPair>, PropPair>("map");
+	TestNonPropagating<sjtu::map<int, std::string, std::less<int>, FixedPair>, FixedPair>("map");
+	return 0;
+}
@@ -0,0 +1,80 @@
+#include "btree_map.hpp"
+
+#include <iostream>
+#include <string>
+
+void TestInsertFind()
+{
+	std::cout << "Testing insert and find..." << std::endl;
+	sjtu::btree_map<int, int> m;
+	for (int i = 0; i < 20000; ++i) {
+		m[i * 7919 % 20011] = i;
+	}
+	std::cout << m.size() << " " << m.count(7919) << " " << m.count(20010) << std::endl;
+	std::cout << m.at(7919) << " " << m.find(15838)->second << std::endl;
+	std::cout << (m.find(-1) == m.end()) << " " << m.insert(sjtu::pair<const int, int>(7919, 5)).second << std::endl;
+	long long sum = 0;
+	int prev = -1, sorted = 1;
+	for (sjtu::btree_map<int, int>::const_iterator it = m.cbegin(); it != m.cend(); ++it) {
+		if (it->first <= prev) sorted = 0;
+		prev = it->first;
+		sum += it->second;
+	}
+	std::cout << sorted << " " << sum << std::endl;
+}
+
+void TestRankAndErase()
+{
+	std::cout << "Testing getByRank and erase..." << std::endl;
+	sjtu::btree_map<std::string, int> m;
+	for (int i = 0; i < 3000; ++i) {
+		m[std::to_string(i)] = i;
+	}
+	std::cout << m.getByRank(1)->first << " " << m.getByRank(3000)->first << " " << m.getByRank(1500)->first << std::endl;
+	for (int i = 0; i < 3000; i += 2) {
+		m.erase(m.find(std::to_string(i)));
+	}
+	std::cout << m.size() << " " << m.getByRank(1)->first << " " << m.getByRank(750)->first << std::endl;
+	sjtu::btree_map<std::string, int> c(m);
+	m.clear();
+	sjtu::btree_map<std::string, int>::iterator it = c.end();
+	--it;
+	std::cout << m.size() << " " << c.size() << " " << it->first << std::endl;
+}
+
+void TestException()
+{
+	sjtu::btree_map<int, int> m;
+	int cnt = 0;
+	try {
+		m.at(1);
+	} catch (...) {
+		++cnt;
+	}
+	try {
+		m.erase(m.end());
+	} catch (...) {
+		++cnt;
+	}
+	m[1] = 1;
+	try {
+		m.getByRank(2);
+	} catch (...) {
+		++cnt;
+	}
+	try {
+		--m.begin();
+	} catch (...) {
+		++cnt;
+	}
+	if (cnt == 4) std::cout << "exceptions thrown correctly." << std::endl;
+	else std::cout << "exceptions not thrown correctly." << std::endl;
+}
+
+int main()
+{
+	TestInsertFind();
+	TestRankAndErase();
+	TestException();
+	return 0;
+}
@@ -0,0 +1,85 @@
+#include "concurrent_map.hpp"
+
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+void TestBasic()
+{
+	std::cout << "Testing single thread..." << std::endl;
+	sjtu::concurrent_map<int, std::string> m;
+	for (int i = 0; i < 10; ++i) {
+		m.insert(sjtu::pair<const int, std::string>(i, std::to_string(i * i)));
+	}
+	std::cout << m.insert(sjtu::pair<const int, std::string>(3, "x")) << " ";
+	std::cout << m.insert_or_assign(3, "three") << " " << m.insert_or_assign(20, "twenty") << std::endl;
+	std::cout << m.erase(5) << " " << m.erase(5) << " " << m.size() << " " << m.count(5) << std::endl;
+	std::string s;
+	std::cout << m.find(3, s) << " " << s << " " << m.at(20) << std::endl;
+	m.for_each([](const sjtu::pair<const int, std::string> &v) {
+		std::cout << v.first << ":" << v.second << " ";
+	});
+	std::cout << std::endl;
+	m.clear();
+	std::cout << m.size() << " " << m.empty() << " " << m.find(3, s) << std::endl;
+}
+
+void TestReaders()
+{
+	std::cout << "Testing readers against a writer..." << std::endl;
+	const int n = 20000;
+	sjtu::concurrent_map<int, long> m;
+	for (int i = 0; i < n; i += 2) {
+		m.insert(sjtu::pair<const int, long>(i, i * 3L));
+	}
+	std::vector<std::thread> readers;
+	std::vector<long> bad(4, 0);
+	for (int k = 0; k < 4; ++k) {
+		readers.push_back(std::thread([&m, &bad, k, n]() {
+			for (int round = 0; round < 5; ++round) {
+				for (int i = k; i < n; i += 4) {
+					long v;
+					// even keys never leave, odd ones come and go
+					if (m.find(i, v) ? v != i * 3L : i % 2 == 0) ++bad[k];
+				}
+			}
+		}));
+	}
+	for (int round = 0; round < 3; ++round) {
+		for (int i = 1; i < n; i += 2) {
+			m.insert_or_assign(i, i * 3L);
+		}
+		for (int i = 1; i < n; i += 2) {
+			m.erase(i);
+		}
+	}
+	for (int k = 0; k < 4; ++k) readers[k].join();
+	std::cout << bad[0] + bad[1] + bad[2] + bad[3] << " " << m.size() << std::endl;
+	long sum = 0;
+	m.for_each([&sum](const sjtu::pair<const int, long> &v) {
+		sum += v.second;
+	});
+	std::cout << sum << std::endl;
+}
+
+void TestException()
+{
+	sjtu::concurrent_map<int, int> m;
+	m.insert(sjtu::pair<const int, int>(1, 1));
+	try {
+		m.at(2);
+		std::cout << "exceptions not thrown." << std::endl;
+		return;
+	}
+	catch (...) {}
+	std::cout << "exceptions thrown correctly." << std::endl;
+}
+
+int main()
+{
+	TestBasic();
+	TestReaders();
+	TestException();
+	return 0;
+}
@@ -0,0 +1,80 @@
+#include "deque.hpp"
+
+#include <deque>
+#include <iostream>
+#include <string>
+
+// counts live instances, copies and moves
+class Counted {
+public:
+	static int live, copies, moves;
+	std::string s;
+	explicit Counted(const std::string &x): s(x) {
+		++live;
+	}
+	Counted(const Counted &other): s(other.s) {
+		++live;
+		++copies;
+	}
+	Counted(Counted &&other) noexcept: s(std::move(other.s)) {
+		++live;
+		++moves;
+	}
+	Counted &operator=(const Counted &other) {
+		s = other.s;
+		return *this;
+	}
+	~Counted() {
+		--live;
+	}
+};
+int Counted::live = 0, Counted::copies = 0, Counted::moves = 0;
+
+bool Same(const sjtu::deque<Counted> &d, const std::deque<int> &ref)
+{
+	if (d.size() != ref.size()) return false;
+	size_t i = 0;
+	for (sjtu::deque<Counted>::const_iterator it = d.cbegin(); it != d.cend(); ++it, ++i) {
+		if ((*it).s != std::to_string(ref[i])) return false;
+	}
+	return true;
+}
+
+// pushes fill blocks to the brim, so every middle insert splits one and
+// the erases then merge them back; elements must only ever be moved
+void TestSplitMerge()
+{
+	std::cout << "Testing block split and merge with a counted type..." << std::endl;
+	{
+		sjtu::deque<Counted> d;
+		std::deque<int> ref;
+		int given = 0;
+		for (int i = 0; i < 5000; ++i, ++given) {
+			d.push_back(Counted(std::to_string(i)));
+			ref.push_back(i);
+		}
+		int movesBefore = Counted::moves;
+		for (int i = 0; i < 40; ++i, ++given) {
+			size_t pos = 123 + i * 97;
+			d.insert(d.begin() + pos, Counted(std::to_string(-i)));
+			ref.insert(ref.begin() + pos, -i);
+		}
+		std::cout << Same(d, ref) << " " << d.size() << " " << Counted::live << std::endl;
+		std::cout << (Counted::copies == given) << " " << (Counted::moves > movesBefore) << std::endl;
+		movesBefore = Counted::moves;
+		for (int i = 0; i < 4000; ++i) {
+			size_t pos = (i * 7919) % ref.size();
+			d.erase(d.begin() + pos);
+			ref.erase(ref.begin() + pos);
+		}
+		std::cout << Same(d, ref) << " " << d.size() << " " << Counted::live << std::endl;
+		std::cout << (Counted::copies == given) << " " << (Counted::moves > movesBefore) << std::endl;
+	}
+	std::cout << Counted::live << std::endl;
+}
+
+int main()
+{
+	TestSplitMerge();
+	return 0;
+}
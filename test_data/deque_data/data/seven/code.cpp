@@ -0,0 +1,51 @@
+#include "deque.hpp"
+
+#include <iostream>
+#include <string>
+
+// inserting an element of the deque itself into the block it lives in:
+// the copy must be taken before the block's tail is shifted
+void TestSelfInsert()
+{
+	std::cout << "Testing insert of the deque's own elements..." << std::endl;
+	sjtu::deque<std::string> d;
+	d.push_back(std::string(40, 'a'));
+	d.push_back(std::string(40, 'b'));
+	d.push_back(std::string(40, 'c'));
+	d.insert(d.begin(), d[1]);
+	d.insert(d.begin(), d[0]);
+	d.insert(d.begin() + 3, d[4]);
+	d.insert(d.end(), d[2]);
+	d.push_front(d.back());
+	d.push_back(d.front());
+	for (size_t i = 0; i < d.size(); ++i) {
+		std::cout << d[i].substr(0, 3) << " " << d[i].size() << std::endl;
+	}
+}
+
+void TestManySelfInserts()
+{
+	std::cout << "Testing many inserts of the deque's own elements..." << std::endl;
+	sjtu::deque<std::string> d;
+	for (int i = 0; i < 100; ++i) {
+		d.push_back(std::to_string(i) + std::string(30, '.'));
+	}
+	// enough to fill, split and merge blocks along the way
+	for (int i = 0; i < 3000; ++i) {
+		size_t from = (i * 7919) % d.size(), to = (i * 104729) % (d.size() + 1);
+		d.insert(d.begin() + to, d[from]);
+	}
+	size_t broken = 0, total = 0;
+	for (size_t i = 0; i < d.size(); ++i) {
+		if (d[i].size() < 31) ++broken;
+		total += d[i].size();
+	}
+	std::cout << d.size() << " " << broken << " " << total << std::endl;
+}
+
+int main()
+{
+	TestSelfInsert();
+	TestManySelfInserts();
+	return 0;
+}
@@ -0,0 +1,70 @@
+#include "flat_map.hpp"
+
+#include <iostream>
+#include <string>
+#include <utility>
+
+void TestBulkBuild()
+{
+	std::cout << "Testing bulk construction..." << std::endl;
+	std::pair<std::string, int> input[] = {
+		std::make_pair("pear", 1), std::make_pair("apple", 2), std::make_pair("fig", 3),
+		std::make_pair("apple", 4), std::make_pair("kiwi", 5), std::make_pair("fig", 6)
+	};
+	sjtu::flat_map<std::string, int> m(input, input + 6);
+	std::cout << m.size() << std::endl;
+	for (sjtu::flat_map<std::string, int>::const_iterator it = m.cbegin(); it != m.cend(); ++it) {
+		std::cout << it->first << ":" << it->second << " ";
+	}
+	std::cout << std::endl;
+	std::cout << m.at("apple") << " " << m.count("fig") << " " << m.count("plum") << " " << m.getByRank(3)->first << std::endl;
+}
+
+void TestModify()
+{
+	std::cout << "Testing insert, erase and operator[]..." << std::endl;
+	sjtu::flat_map<int, int> m;
+	for (int i = 0; i < 1000; ++i) {
+		m[i * 37 % 1009] = i;
+	}
+	std::cout << m.size() << " " << m.getByRank(1)->first << " " << m.getByRank(1000)->first << std::endl;
+	for (int i = 0; i < 1009; i += 3) {
+		sjtu::flat_map<int, int>::iterator it = m.find(i);
+		if (it != m.end()) m.erase(it);
+	}
+	std::cout << m.size() << " " << m.insert(sjtu::pair<const int, int>(1, 7)).second << " " << m[1] << std::endl;
+	m.find(2)->second = 42;
+	const sjtu::flat_map<int, int> c(m);
+	std::cout << c.at(2) << " " << (c.find(3) == c.cend()) << std::endl;
+}
+
+void TestException()
+{
+	sjtu::flat_map<int, int> m;
+	int cnt = 0;
+	try {
+		m.at(1);
+	} catch (...) {
+		++cnt;
+	}
+	try {
+		m.getByRank(1);
+	} catch (...) {
+		++cnt;
+	}
+	try {
+		m.begin()++;
+	} catch (...) {
+		++cnt;
+	}
+	if (cnt == 3) std::cout << "exceptions thrown correctly." << std::endl;
+	else std::cout << "exceptions not thrown correctly." << std::endl;
+}
+
+int main()
+{
+	TestBulkBuild();
+	TestModify();
+	TestException();
+	return 0;
+}
@@ -0,0 +1,129 @@
+#include "map.hpp"
+#include <iostream>
+#include <map>
+#include <vector>
+#include <string>
+#include <cstdlib>
+#include <algorithm>
+#include <utility>
+
+typedef sjtu::map<int, std::string> Map;
+
+void print(const Map &m) {
+	std::cout << m.size() << ":";
+	for (Map::const_iterator it = m.cbegin(); it != m.cend(); ++it)
+		std::cout << " " << it->first << "=" << it->second;
+	std::cout << std::endl;
+}
+
+// walks both directions and checks every rank against the reference
+bool same(Map &m, const std::map<int, std::string> &ref) {
+	if (m.size() != ref.size()) return false;
+	Map::iterator it = m.begin();
+	int rank = 1;
+	for (std::map<int, std::string>::const_iterator r = ref.begin(); r != ref.end(); ++r, ++it, ++rank) {
+		if (it == m.end() || it->first != r->first || it->second != r->second) return false;
+		if (m.getByRank(rank)->first != r->first) return false;
+	}
+	if (it != m.end()) return false;
+	for (std::map<int, std::string>::const_reverse_iterator r = ref.rbegin(); r != ref.rend(); ++r)
+		if ((--it)->first != r->first) return false;
+	return it == m.begin();
+}
+
+void testRangeConstructor() {
+	std::cout << "range constructor" << std::endl;
+	std::vector<std::pair<int, std::string>> sorted, shuffled, dup;
+	for (int i = 1; i <= 7; ++i) sorted.push_back(std::make_pair(i * 10, std::to_string(i)));
+	print(Map(sorted.begin(), sorted.end()));
+	int order[] = {50, 20, 70, 10, 40, 60, 30};
+	for (int k : order) shuffled.push_back(std::make_pair(k, std::to_string(k / 10)));
+	print(Map(shuffled.begin(), shuffled.end()));
+	// of equal keys the first one wins, sorted or not
+	dup.push_back(std::make_pair(3, std::string("first")));
+	dup.push_back(std::make_pair(1, std::string("a")));
+	dup.push_back(std::make_pair(3, std::string("second")));
+	dup.push_back(std::make_pair(2, std::string("b")));
+	dup.push_back(std::make_pair(1, std::string("again")));
+	dup.push_back(std::make_pair(3, std::string("third")));
+	print(Map(dup.begin(), dup.end()));
+	std::vector<std::pair<int, std::string>> runs;
+	for (int i = 0; i < 6; ++i) runs.push_back(std::make_pair(i / 2, std::string(1, char('a' + i))));
+	print(Map(runs.begin(), runs.end()));
+	print(Map(sorted.begin(), sorted.begin()));
+
+	std::vector<std::pair<int, std::string>> big;
+	std::map<int, std::string> ref;
+	for (int i = 0; i < 20000; ++i) {
+		int k = rand() % 5000;
+		big.push_back(std::make_pair(k, std::to_string(i)));
+		ref.insert(std::make_pair(k, std::to_string(i)));
+	}
+	Map m(big.begin(), big.end());
+	std::cout << (same(m, ref) ? "random range OK" : "random range FAIL") << std::endl;
+	int smallest = ref.begin()->first;
+	m.erase(m.find(smallest));
+	ref.erase(smallest);
+	m[-1] = "new";
+	ref[-1] = "new";
+	std::cout << (same(m, ref) ? "modify after build OK" : "modify after build FAIL") << std::endl;
+}
+
+void testInsertSorted() {
+	std::cout << "insert_sorted" << std::endl;
+	Map m;
+	m[20] = "old20";
+	m[40] = "old40";
+	std::vector<std::pair<int, std::string>> batch;
+	int keys[] = {30, 10, 40, 50, 20, 30, 5};
+	for (int i = 0; i < 7; ++i) batch.push_back(std::make_pair(keys[i], "new" + std::to_string(i)));
+	// keys already present keep their values; the first 30 of the batch wins
+	m.insert_sorted(batch.begin(), batch.end());
+	print(m);
+	m.insert_sorted(batch.begin(), batch.begin());
+	print(m);
+	std::vector<std::pair<int, std::string>> tail;
+	for (int i = 6; i <= 9; ++i) tail.push_back(std::make_pair(i * 10, "t" + std::to_string(i)));
+	m.insert_sorted(tail.begin(), tail.end());
+	print(m);
+
+	Map e;
+	e.insert_sorted(tail.begin(), tail.end());
+	print(e);
+
+	Map r;
+	std::map<int, std::string> ref;
+	for (int round = 0; round < 20; ++round) {
+		std::vector<std::pair<int, std::string>> b;
+		int n = rand() % 500;
+		for (int i = 0; i < n; ++i) {
+			int k = rand() % 3000;
+			std::string v = std::to_string(round) + "/" + std::to_string(i);
+			b.push_back(std::make_pair(k, v));
+			ref.insert(std::make_pair(k, v));
+		}
+		if (round % 2 == 0) std::stable_sort(b.begin(), b.end(),
+			[](const std::pair<int, std::string> &x, const std::pair<int, std::string> &y) { return x.first < y.first; });
+		r.insert_sorted(b.begin(), b.end());
+		for (int i = 0; i < 50; ++i) {
+			int k = rand() % 3000;
+			Map::iterator it = r.find(k);
+			if (it != r.end()) {
+				r.erase(it);
+				ref.erase(k);
+			}
+		}
+		if (!same(r, ref)) {
+			std::cout << "random insert_sorted FAIL at round " << round << std::endl;
+			return;
+		}
+	}
+	std::cout << "random insert_sorted OK" << std::endl;
+}
+
+int main() {
+	srand(2013);
+	testRangeConstructor();
+	testInsertSorted();
+	return 0;
+}
@@ -0,0 +1,117 @@
+#include "map.hpp"
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+#include <iterator>
+#include <functional>
+#include <cstdlib>
+
+typedef sjtu::map<int, int> Map;
+
+// a key made from a const char *, counting how often that happens
+class Name {
+public:
+	static int made;
+	std::string s;
+	Name(const char *p): s(p) {
+		++made;
+	}
+	bool operator<(const Name &rhs) const {
+		return s < rhs.s;
+	}
+};
+int Name::made = 0;
+
+template<class M, class It>
+void print(const M &m, It first, It last) {
+	for (; first != last; ++first) {
+		if (*first == m.cend()) std::cout << " end";
+		else std::cout << " " << (*first)->second;
+	}
+	std::cout << std::endl;
+}
+
+int main() {
+	Map m;
+	for (int i = 0; i < 50; ++i) m[i * 3] = i;
+	const Map &c = m;
+
+	// fewer than 16 keys: one group, present and absent mixed
+	std::vector<int> few = {0, 1, 3, 148, 147, -3, 9, 9};
+	std::vector<Map::const_iterator> out;
+	c.find_batch(few.begin(), few.end(), std::back_inserter(out));
+	std::cout << out.size() << ":";
+	print(c, out.begin(), out.end());
+
+	// exactly 16, and 40, which spans three groups
+	std::vector<int> sixteen, forty;
+	for (int i = 0; i < 16; ++i) sixteen.push_back(i * 2);
+	for (int i = 0; i < 40; ++i) forty.push_back(150 - i * 4);
+	out.clear();
+	c.find_batch(sixteen.begin(), sixteen.end(), std::back_inserter(out));
+	std::cout << out.size() << ":";
+	print(c, out.begin(), out.end());
+	out.clear();
+	c.find_batch(forty.begin(), forty.end(), std::back_inserter(out));
+	std::cout << out.size() << ":";
+	print(c, out.begin(), out.end());
+
+	// writable iterators, into a plain array; an empty batch writes nothing
+	Map::iterator its[3];
+	int keys[] = {30, 31, 33};
+	Map::iterator *end = m.find_batch(keys, keys + 3, its);
+	std::cout << end - its << ":";
+	for (int i = 0; i < 3; ++i) {
+		if (its[i] != m.end()) its[i]->second = -1;
+	}
+	std::cout << " " << m[30] << " " << m[33] << std::endl;
+	std::cout << (m.find_batch(keys, keys, its) == its ? "empty batch OK" : "empty batch FAIL") << std::endl;
+	Map empty;
+	Map::iterator none[2];
+	empty.find_batch(keys, keys + 2, none);
+	std::cout << (none[0] == empty.end() && none[1] == empty.end() ? "empty map OK" : "empty map FAIL") << std::endl;
+
+	// probes of another type: converted once each without a transparent
+	// comparator, compared as they are with one
+	sjtu::map<Name, int> names;
+	sjtu::map<std::string, int, std::less<>> strs;
+	const char *words[] = {"ant", "bee", "cat", "dog", "eel", "fox", "gnu", "hen", "ibis", "jay"};
+	for (int i = 0; i < 10; ++i) {
+		if (i % 3 == 0) continue;
+		names[Name(words[i])] = i;
+		strs[words[i]] = i;
+	}
+	std::vector<const char *> probes;
+	for (int r = 0; r < 3; ++r)
+		for (int i = 0; i < 10; ++i) probes.push_back(words[i]);
+	Name::made = 0;
+	std::vector<sjtu::map<Name, int>::const_iterator> nout;
+	static_cast<const sjtu::map<Name, int> &>(names).find_batch(probes.begin(), probes.end(), std::back_inserter(nout));
+	std::cout << nout.size() << " probes, keys made " << Name::made << ":";
+	print(names, nout.begin(), nout.begin() + 10);
+	std::vector<sjtu::map<std::string, int, std::less<>>::const_iterator> sout;
+	static_cast<const sjtu::map<std::string, int, std::less<>> &>(strs).find_batch(probes.begin(), probes.end(), std::back_inserter(sout));
+	std::cout << sout.size() << ":";
+	print(strs, sout.begin() + 20, sout.end());
+
+	// random batches of random sizes against find
+	Map r;
+	for (int i = 0; i < 20000; ++i) r[rand()] = i;
+	bool ok = true;
+	for (int round = 0; round < 200 && ok; ++round) {
+		std::vector<int> batch;
+		int n = rand() % 50;
+		for (int j = 0; j < n; ++j) {
+			Map::iterator pick = r.getByRank(rand() % r.size() + 1);
+			batch.push_back(j % 2 ? pick->first : rand());
+		}
+		std::vector<Map::iterator> res;
+		r.find_batch(batch.begin(), batch.end(), std::back_inserter(res));
+		if (res.size() != batch.size()) ok = false;
+		for (size_t i = 0; i < res.size() && ok; ++i)
+			if (res[i] != r.find(batch[i])) ok = false;
+	}
+	std::cout << (ok ? "random batches OK" : "random batches FAIL") << std::endl;
+	return 0;
+}
@@ -0,0 +1,87 @@
+#include "map.hpp"
+#include <iostream>
+#include <map>
+#include <vector>
+#include <utility>
+#include <cstdlib>
+
+typedef sjtu::map<int, int> Map;
+
+void print(const Map &m) {
+	std::cout << m.size() << ":";
+	for (Map::const_iterator it = m.cbegin(); it != m.cend(); ++it)
+		std::cout << " " << it->first;
+	std::cout << std::endl;
+}
+
+bool same(Map &m, const std::map<int, int> &ref) {
+	if (m.size() != ref.size()) return false;
+	Map::iterator it = m.begin();
+	int rank = 1;
+	for (std::map<int, int>::const_iterator r = ref.begin(); r != ref.end(); ++r, ++it, ++rank) {
+		if (it == m.end() || it->first != r->first || it->second != r->second) return false;
+		if (m.getByRank(rank)->first != r->first) return false;
+	}
+	if (it != m.end()) return false;
+	for (std::map<int, int>::const_reverse_iterator r = ref.rbegin(); r != ref.rend(); ++r)
+		if ((--it)->first != r->first) return false;
+	return it == m.begin();
+}
+
+int main() {
+	// built from a sorted range the tree is perfect: 8 at the root, 4 and
+	// 12 under it, then 2, 6, 10 and 14, each with two children
+	std::vector<std::pair<int, int>> keys;
+	for (int i = 1; i <= 15; ++i) keys.push_back(std::make_pair(i, i * 100));
+	Map m(keys.begin(), keys.end());
+	std::vector<Map::iterator> its;
+	std::vector<int *> vals;
+	for (Map::iterator it = m.begin(); it != m.end(); ++it) {
+		its.push_back(it);
+		vals.push_back(&it->second);
+	}
+	// 8's successor 9 sits at the bottom of its right subtree; 2's
+	// successor 3 is its own right child
+	int order[] = {8, 12, 2, 4, 6, 10};
+	bool gone[16] = {};
+	for (int k : order) {
+		m.erase(m.find(k));
+		gone[k] = true;
+		print(m);
+		// every other iterator, and the value it points at, is untouched
+		for (int i = 1; i <= 15; ++i) {
+			if (gone[i]) continue;
+			if (its[i - 1]->first != i || &its[i - 1]->second != vals[i - 1] || *vals[i - 1] != i * 100)
+				std::cout << "iterator to " << i << " broken after erasing " << k << std::endl;
+		}
+		for (int r = 1; r <= (int)m.size(); ++r) std::cout << m.getByRank(r)->first << " ";
+		std::cout << std::endl;
+	}
+	// erasing the element it points at moves nothing else
+	Map::iterator nine = m.find(9);
+	m.erase(m.find(11));
+	std::cout << "next after 9: " << (++nine)->first << std::endl;
+
+	// the middle rank is an interior node of a balanced tree almost always
+	Map r;
+	std::map<int, int> ref;
+	for (int i = 0; i < 4000; ++i) {
+		int k = rand();
+		r[k] = i;
+		ref[k] = i;
+	}
+	bool ok = true;
+	for (int step = 1; r.size() > 0 && ok; ++step) {
+		Map::iterator mid = r.getByRank((r.size() + 1) / 2);
+		ref.erase(mid->first);
+		r.erase(mid);
+		if (step % 97 == 0) ok = same(r, ref);
+		if (step % 5 == 0) {
+			int k = rand();
+			r[k] = k;
+			ref[k] = k;
+		}
+	}
+	std::cout << (ok && same(r, ref) ? "middle erases OK" : "middle erases FAIL") << std::endl;
+	return 0;
+}
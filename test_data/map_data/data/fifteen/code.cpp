@@ -0,0 +1,145 @@
+#include "map.hpp"
+#include <iostream>
+#include <map>
+#include <cstdlib>
+
+typedef sjtu::map<int, int> Map;
+
+// forwards with values, then backwards, and the ranks
+void print(const char *name, Map &m) {
+	std::cout << name << " " << m.size() << ":";
+	for (Map::iterator it = m.begin(); it != m.end(); ++it) std::cout << " " << it->first << "=" << it->second;
+	std::cout << " |";
+	if (!m.empty()) {
+		Map::iterator it = m.end();
+		do {
+			--it;
+			std::cout << " " << it->first;
+		} while (it != m.begin());
+	}
+	bool ranks = true;
+	int r = 1;
+	for (Map::iterator it = m.begin(); it != m.end(); ++it, ++r)
+		if (m.getByRank(r) != it) ranks = false;
+	std::cout << (ranks ? "" : " (ranks wrong)") << std::endl;
+}
+
+bool same(Map &m, const std::map<int, int> &ref) {
+	if (m.size() != ref.size()) return false;
+	Map::iterator it = m.begin();
+	int rank = 1;
+	for (std::map<int, int>::const_iterator r = ref.begin(); r != ref.end(); ++r, ++it, ++rank) {
+		if (it == m.end() || it->first != r->first || it->second != r->second) return false;
+		if (m.getByRank(rank)->first != r->first) return false;
+	}
+	if (it != m.end()) return false;
+	for (std::map<int, int>::const_reverse_iterator r = ref.rbegin(); r != ref.rend(); ++r)
+		if ((--it)->first != r->first) return false;
+	return it == m.begin();
+}
+
+// ours holds 1..8, theirs the even keys 4..14, values telling them apart
+void fill(Map &ours, Map &theirs) {
+	for (int i = 1; i <= 8; ++i) ours[i] = i;
+	for (int i = 4; i <= 14; i += 2) theirs[i] = -i;
+}
+
+int main() {
+	{
+		Map a, b;
+		fill(a, b);
+		a.merge_union(b);
+		print("union", a);
+		print("other", b);
+		a[0] = 0;
+		a[100] = 100;
+		a.erase(a.find(12));
+		print("then", a);
+	}
+	{
+		Map a, b;
+		fill(a, b);
+		a.merge_intersection(b);
+		print("intersection", a);
+		print("other", b);
+		a[5] = 5;
+		print("then", a);
+	}
+	{
+		Map a, b;
+		fill(a, b);
+		a.merge_difference(b);
+		print("difference", a);
+		print("other", b);
+		a[4] = 4;
+		print("then", a);
+	}
+	{
+		// no common keys, and a map merged with itself
+		Map a, b, e;
+		fill(a, b);
+		Map high = b.split(9);
+		a.merge_intersection(high);
+		print("disjoint intersection", a);
+		fill(a, b);
+		a.merge_union(a);
+		print("self union", a);
+		a.merge_difference(e);
+		print("minus empty", a);
+		e.merge_union(a);
+		print("empty union", e);
+		print("other", a);
+		e.merge_difference(e);
+		print("self difference", e);
+	}
+
+	// random merges against std::map
+	bool ok = true;
+	for (int round = 0; round < 60 && ok; ++round) {
+		Map a, b;
+		std::map<int, int> ra, rb;
+		int na = rand() % 2000, nb = rand() % 2000, range = rand() % 5000 + 1;
+		for (int i = 0; i < na; ++i) {
+			int k = rand() % range;
+			a[k] = i;
+			ra[k] = i;
+		}
+		for (int i = 0; i < nb; ++i) {
+			int k = rand() % range;
+			b[k] = -i;
+			rb[k] = -i;
+		}
+		std::map<int, int> expect;
+		if (round % 3 == 0) {
+			expect = ra;
+			expect.insert(rb.begin(), rb.end());
+			a.merge_union(b);
+		}
+		else if (round % 3 == 1) {
+			for (std::map<int, int>::iterator it = ra.begin(); it != ra.end(); ++it)
+				if (rb.count(it->first)) expect.insert(*it);
+			a.merge_intersection(b);
+		}
+		else {
+			for (std::map<int, int>::iterator it = ra.begin(); it != ra.end(); ++it)
+				if (!rb.count(it->first)) expect.insert(*it);
+			a.merge_difference(b);
+		}
+		if (!same(a, expect) || b.size() != 0 || b.begin() != b.end()) ok = false;
+		for (int i = 0; i < 100; ++i) {
+			int k = rand() % range;
+			Map::iterator f = a.find(k);
+			if (f != a.end()) {
+				a.erase(f);
+				expect.erase(k);
+			}
+			else {
+				a[k] = k;
+				expect[k] = k;
+			}
+		}
+		if (!same(a, expect)) ok = false;
+	}
+	std::cout << (ok ? "random merges OK" : "random merges FAIL") << std::endl;
+	return 0;
+}
@@ -0,0 +1,129 @@
+#include "map.hpp"
+#include <iostream>
+#include <map>
+#include <cstdlib>
+
+typedef sjtu::map<int, int> Map;
+
+// size, keys, and whether every rank leads back to the right key
+void print(const char *name, Map &m) {
+	std::cout << name << " " << m.size() << ":";
+	for (Map::iterator it = m.begin(); it != m.end(); ++it) std::cout << " " << it->first;
+	bool ranks = true;
+	int r = 1;
+	for (Map::iterator it = m.begin(); it != m.end(); ++it, ++r)
+		if (m.getByRank(r) != it || m.rank_of(it->first) != r) ranks = false;
+	std::cout << (ranks ? "" : " (ranks wrong)") << std::endl;
+}
+
+bool same(Map &m, const std::map<int, int> &ref) {
+	if (m.size() != ref.size()) return false;
+	Map::iterator it = m.begin();
+	int rank = 1;
+	for (std::map<int, int>::const_iterator r = ref.begin(); r != ref.end(); ++r, ++it, ++rank) {
+		if (it == m.end() || it->first != r->first || it->second != r->second) return false;
+		if (m.getByRank(rank)->first != r->first) return false;
+	}
+	if (it != m.end()) return false;
+	for (std::map<int, int>::const_reverse_iterator r = ref.rbegin(); r != ref.rend(); ++r)
+		if ((--it)->first != r->first) return false;
+	return it == m.begin();
+}
+
+int main() {
+	Map a;
+	for (int i = 1; i <= 12; ++i) a[i * 10] = i;
+	Map b = a.split(65);
+	print("a", a);
+	print("b", b);
+	Map c = b.split(90);
+	print("b", b);
+	print("c", c);
+	Map none = c.split(1000);
+	print("c", c);
+	print("none", none);
+	Map all = a.split(-1);
+	print("a", a);
+	print("all", all);
+
+	// both halves go on taking inserts from the shared pool
+	all[25] = 0;
+	b[75] = 0;
+	c[95] = 0;
+	print("all", all);
+	print("b", b);
+	print("c", c);
+
+	// join takes the other map's keys from above or from below
+	all.join(b);
+	print("all", all);
+	print("b", b);
+	c.join(all);
+	print("c", c);
+	print("all", all);
+	c.join(none);
+	print("c", c);
+	// keys on both sides of ours: refused, and neither map changes
+	Map mixed;
+	mixed[5] = 0;
+	mixed[200] = 0;
+	try {
+		c.join(mixed);
+		std::cout << "overlap joined" << std::endl;
+	} catch (sjtu::runtime_error &) {
+		std::cout << "overlap refused" << std::endl;
+	}
+	print("c", c);
+	print("mixed", mixed);
+	Map inside;
+	inside[33] = 0;
+	try {
+		c.join(inside);
+		std::cout << "overlap joined" << std::endl;
+	} catch (sjtu::runtime_error &) {
+		std::cout << "overlap refused" << std::endl;
+	}
+	print("c", c);
+	print("inside", inside);
+
+	// a map with its own pool joins by copying
+	Map low;
+	for (int i = -5; i < 0; ++i) low[i] = i;
+	c.join(low);
+	print("c", c);
+	print("low", low);
+
+	// split and rejoin random maps against std::map
+	Map r;
+	std::map<int, int> ref;
+	for (int i = 0; i < 5000; ++i) {
+		int k = rand() % 100000;
+		r[k] = i;
+		ref[k] = i;
+	}
+	bool ok = true;
+	for (int round = 0; round < 200 && ok; ++round) {
+		int key = rand() % 110000 - 5000;
+		Map upper = r.split(key);
+		std::map<int, int> refUpper(ref.lower_bound(key), ref.end());
+		std::map<int, int> refLower(ref.begin(), ref.lower_bound(key));
+		if (!same(r, refLower) || !same(upper, refUpper)) ok = false;
+		int k = rand() % 100000;
+		if (k < key) {
+			r[k] = -round;
+			ref[k] = -round;
+		}
+		else {
+			upper[k] = -round;
+			ref[k] = -round;
+		}
+		if (round & 1) r.join(upper);
+		else {
+			upper.join(r);
+			r.swap(upper);
+		}
+		if (!same(r, ref) || upper.size() != 0) ok = false;
+	}
+	std::cout << (ok ? "random split/join OK" : "random split/join FAIL") << std::endl;
+	return 0;
+}
@@ -0,0 +1,84 @@
+#include "map.hpp"
+#include <iostream>
+#include <string>
+
+// counts how many values get built, so the hit paths can be seen to build none
+class Value {
+public:
+	static int built;
+	std::string s;
+	Value(const std::string &a, int n): s(a + std::to_string(n)) {
+		++built;
+	}
+	Value(const std::string &a): s(a) {
+		++built;
+	}
+	Value(): s("default") {
+		++built;
+	}
+	Value(const Value &rhs): s(rhs.s) {
+		++built;
+	}
+	Value &operator=(const Value &rhs) {
+		s = rhs.s;
+		return *this;
+	}
+};
+int Value::built = 0;
+
+typedef sjtu::map<int, Value> Map;
+
+void print(const Map &m) {
+	std::cout << m.size() << ":";
+	for (Map::const_iterator it = m.cbegin(); it != m.cend(); ++it)
+		std::cout << " " << it->first << "=" << it->second.s;
+	std::cout << std::endl;
+}
+
+// built is only printed where the count does not depend on how many
+// temporaries the caller's argument took
+template<class Result>
+void report(const char *what, const Result &r, bool showBuilt = false) {
+	std::cout << what << ": key " << r.first->first << " value " << r.first->second.s
+	          << " inserted " << r.second;
+	if (showBuilt) std::cout << " built " << Value::built;
+	std::cout << std::endl;
+	Value::built = 0;
+}
+
+int main() {
+	Map m;
+	// try_emplace builds the value from its arguments on a miss only
+	report("try_emplace miss", m.try_emplace(5, std::string("five"), 5), true);
+	report("try_emplace hit", m.try_emplace(5, std::string("FIVE"), 55), true);
+	report("try_emplace no args", m.try_emplace(3), true);
+	report("try_emplace hit no args", m.try_emplace(3), true);
+	Value::built = 0;
+	// insert_or_assign overwrites on a hit
+	report("insert_or_assign miss", m.insert_or_assign(7, Value("seven")));
+	report("insert_or_assign hit", m.insert_or_assign(5, Value("five again")));
+	report("insert_or_assign hit", m.insert_or_assign(7, Value("seven again")));
+	// emplace builds the pair first, and drops it again on a hit
+	report("emplace miss", m.emplace(1, Value("one")));
+	report("emplace hit", m.emplace(1, Value("uno")));
+	report("emplace pair", m.emplace(Map::value_type(9, Value("nine"))));
+	print(m);
+
+	Value::built = 0;
+	m[3].s = "three";
+	m[4].s = "four";
+	std::cout << "operator[] built " << Value::built << std::endl;
+	print(m);
+
+	// the iterators handed back stay usable after later inserts
+	Map::iterator it = m.try_emplace(100, std::string("hundred")).first;
+	for (int i = 0; i < 1000; ++i) m.try_emplace(i * 7 % 1000, std::string("x"), i);
+	std::cout << it->first << "=" << it->second.s << " size " << m.size() << std::endl;
+	int wrong = 0;
+	for (int i = 0; i < 1000; ++i) {
+		Map::iterator f = m.find(i);
+		if (f == m.end()) ++wrong;
+	}
+	std::cout << "missing " << wrong << std::endl;
+	return 0;
+}
@@ -0,0 +1,97 @@
+#include "map.hpp"
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+#include <utility>
+#include <cstdlib>
+
+int lessCalls = 0, compareCalls = 0;
+
+// orders strings by length, then backwards alphabetically, so the map's
+// order comes from the comparator and not from std::string
+struct ByLength {
+	bool operator()(const std::string &a, const std::string &b) const {
+		++lessCalls;
+		return compare(a, b) < 0;
+	}
+	int compare(const std::string &a, const std::string &b) const {
+		++compareCalls;
+		if (a.size() != b.size()) return a.size() < b.size() ? -1 : 1;
+		return b.compare(a);
+	}
+};
+
+struct IntCmp {
+	bool operator()(int a, int b) const {
+		++lessCalls;
+		return a < b;
+	}
+	int compare(int a, int b) const {
+		++compareCalls;
+		return a < b ? -1 : (a == b ? 0 : 1);
+	}
+};
+
+static_assert(sjtu::three_way<ByLength, std::string, std::string>::value, "compare() is picked up");
+static_assert(!sjtu::three_way<std::less<int>, int, long>::value, "std::less<int> does not take mixed keys");
+static_assert(!sjtu::three_way<std::less<std::string>, std::string, std::string>::value, "std::less<Key> keeps using operator<");
+
+int main() {
+	sjtu::map<std::string, int, ByLength> m;
+	const char *words[] = {"bb", "a", "ccc", "ab", "b", "abc", "dd", "z"};
+	for (int i = 0; i < 8; ++i) m[words[i]] = i;
+	m.insert(sjtu::pair<const std::string, int>("ab", 100));
+	std::cout << m.size() << ":";
+	for (auto it = m.cbegin(); it != m.cend(); ++it) std::cout << " " << it->first << "=" << it->second;
+	std::cout << std::endl;
+	const char *probes[] = {"ab", "b", "abc", "zz", "", "abcd"};
+	for (const char *p : probes) {
+		auto it = m.find(p);
+		std::cout << "'" << p << "' " << m.count(p) << " " << (it == m.end() ? std::string("end") : it->first) << std::endl;
+	}
+	m.erase(m.find("bb"));
+	std::cout << "erased bb, rank of abc " << m.rank_of("abc") << ", first of length 2 " << m.lower_bound("zz")->first << std::endl;
+
+	// lookups and inserts go through compare() alone, once per node
+	sjtu::map<int, int, IntCmp> n;
+	std::vector<std::pair<int, int>> keys;
+	for (int i = 0; i < 1023; ++i) keys.push_back(std::make_pair(i * 2, i));
+	n.insert_sorted(keys.begin(), keys.end());
+	lessCalls = compareCalls = 0;
+	int most = 0, found = 0;
+	for (int k = -1; k <= 2046; ++k) {
+		int before = compareCalls;
+		if (n.find(k) != n.end()) ++found;
+		if (compareCalls - before > most) most = compareCalls - before;
+	}
+	std::cout << "found " << found << ", operator() calls " << lessCalls << ", most compare() calls per find " << most << std::endl;
+	lessCalls = compareCalls = 0;
+	for (int k = 0; k < 100; ++k) n[k * 2 + 1] = k;
+	std::cout << "inserts: operator() calls " << lessCalls << ", size " << n.size() << std::endl;
+
+	// random inserts and erases against std::map with the same order
+	sjtu::map<int, int, IntCmp> r;
+	std::map<int, int> ref;
+	bool ok = true;
+	for (int i = 0; i < 20000; ++i) {
+		int k = rand() % 3000;
+		if (i % 3 == 0) {
+			auto f = r.find(k);
+			if (f != r.end()) r.erase(f);
+			ref.erase(k);
+		}
+		else {
+			r[k] = i;
+			ref[k] = i;
+		}
+	}
+	if (r.size() != ref.size()) ok = false;
+	auto it = r.begin();
+	for (auto x : ref) {
+		if (it->first != x.first || it->second != x.second) ok = false;
+		++it;
+	}
+	std::cout << (ok ? "random OK" : "random FAIL") << std::endl;
+	return 0;
+}
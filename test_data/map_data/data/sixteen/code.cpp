@@ -0,0 +1,78 @@
+#include "map.hpp"
+#include <iostream>
+#include <string>
+#include <cstring>
+#include <functional>
+
+typedef sjtu::map<std::string, int, std::less<>> Map;
+
+// a key that counts how often it is made from a const char *, ordered
+// against const char * directly
+class Name {
+public:
+	static int made;
+	std::string s;
+	Name(const char *p): s(p) {
+		++made;
+	}
+	bool operator<(const Name &rhs) const {
+		return s < rhs.s;
+	}
+	friend bool operator<(const Name &a, const char *b) {
+		return std::strcmp(a.s.c_str(), b) < 0;
+	}
+	friend bool operator<(const char *a, const Name &b) {
+		return std::strcmp(a, b.s.c_str()) < 0;
+	}
+};
+int Name::made = 0;
+
+int main() {
+	Map m;
+	const char *words[] = {"pear", "apple", "fig", "kiwi", "banana"};
+	for (int i = 0; i < 5; ++i) m[std::string(words[i])] = i;
+	const Map &c = m;
+	const char *probes[] = {"apple", "kiwi", "grape", "", "zzz"};
+	for (const char *p : probes) {
+		Map::iterator it = m.find(p);
+		Map::const_iterator cit = c.find(p);
+		std::cout << "'" << p << "': count " << c.count(p) << " find "
+		          << (it == m.end() ? std::string("end") : it->first) << " "
+		          << (cit == c.cend() ? std::string("end") : cit->first) << " at ";
+		try {
+			std::cout << c.at(p);
+		} catch (sjtu::index_out_of_bound &) {
+			std::cout << "out of bound";
+		}
+		std::cout << std::endl;
+	}
+	m.at("fig") = 20;
+	m["kiwi"] += 30;
+	m["grape"] = 7;
+	std::cout << m.size() << ":";
+	for (Map::const_iterator it = c.cbegin(); it != c.cend(); ++it) std::cout << " " << it->first << "=" << it->second;
+	std::cout << std::endl;
+	try {
+		std::cout << c["melon"] << std::endl;
+	} catch (sjtu::index_out_of_bound &) {
+		std::cout << "const [] out of bound" << std::endl;
+	}
+
+	// lookups never build a key; operator[] builds one on a miss only
+	sjtu::map<Name, int, std::less<>> n;
+	n[Name("one")] = 1;
+	n[Name("two")] = 2;
+	Name::made = 0;
+	int hits = 0;
+	for (int i = 0; i < 100; ++i) {
+		hits += n.count("one") + n.count("three");
+		if (n.find("two") != n.end()) ++hits;
+		hits += n.at("two");
+	}
+	std::cout << "hits " << hits << " keys made " << Name::made << std::endl;
+	n["two"] = 22;
+	std::cout << "hit [] made " << Name::made << std::endl;
+	n["three"] = 3;
+	std::cout << "miss [] made " << Name::made << " size " << n.size() << " three " << n.at("three") << std::endl;
+	return 0;
+}
@@ -0,0 +1,108 @@
+#include "map.hpp"
+#include <iostream>
+#include <map>
+#include <string>
+#include <cstdlib>
+
+typedef sjtu::map<int, int> Map;
+
+void print(const Map &m) {
+	std::cout << m.size() << ":";
+	for (Map::const_iterator it = m.cbegin(); it != m.cend(); ++it)
+		std::cout << " " << it->first << "=" << it->second;
+	std::cout << std::endl;
+}
+
+bool same(Map &m, const std::map<int, int> &ref) {
+	if (m.size() != ref.size()) return false;
+	Map::iterator it = m.begin();
+	int rank = 1;
+	for (std::map<int, int>::const_iterator r = ref.begin(); r != ref.end(); ++r, ++it, ++rank) {
+		if (it == m.end() || it->first != r->first || it->second != r->second) return false;
+		if (m.getByRank(rank)->first != r->first) return false;
+	}
+	if (it != m.end()) return false;
+	for (std::map<int, int>::const_reverse_iterator r = ref.rbegin(); r != ref.rend(); ++r)
+		if ((--it)->first != r->first) return false;
+	return it == m.begin();
+}
+
+int main() {
+	Map m;
+	// ascending keys with end() as the hint
+	for (int i = 1; i <= 5; ++i) {
+		Map::iterator it = m.insert(m.cend(), Map::value_type(i * 10, i));
+		std::cout << it->first << " ";
+	}
+	std::cout << std::endl;
+	print(m);
+	// the right hint: the element the new key goes before
+	Map::iterator it = m.insert(m.find(30), Map::value_type(25, 0));
+	std::cout << "correct hint -> " << it->first << "=" << it->second << std::endl;
+	it = m.insert(m.cbegin(), Map::value_type(5, 0));
+	std::cout << "begin hint -> " << it->first << "=" << it->second << std::endl;
+	// wrong hints fall back to a descent
+	it = m.insert(m.find(10), Map::value_type(45, 0));
+	std::cout << "early hint -> " << it->first << "=" << it->second << std::endl;
+	it = m.insert(m.cend(), Map::value_type(15, 0));
+	std::cout << "end hint for a small key -> " << it->first << "=" << it->second << std::endl;
+	it = m.insert(m.cbegin(), Map::value_type(100, 0));
+	std::cout << "begin hint for a large key -> " << it->first << "=" << it->second << std::endl;
+	// a key already there is left alone, whatever the hint
+	it = m.insert(m.find(30), Map::value_type(30, 99));
+	std::cout << "present at hint -> " << it->first << "=" << it->second << std::endl;
+	it = m.insert(m.find(40), Map::value_type(30, 99));
+	std::cout << "present before hint -> " << it->first << "=" << it->second << std::endl;
+	it = m.insert(m.cend(), Map::value_type(10, 99));
+	std::cout << "present, wrong hint -> " << it->first << "=" << it->second << std::endl;
+	print(m);
+
+	// emplace_hint, the same three kinds of hint
+	it = m.emplace_hint(m.cend(), 200, 2);
+	std::cout << "emplace_hint end -> " << it->first << "=" << it->second << std::endl;
+	it = m.emplace_hint(m.find(100), 60, 6);
+	std::cout << "emplace_hint correct -> " << it->first << "=" << it->second << std::endl;
+	it = m.emplace_hint(m.cbegin(), 150, 15);
+	std::cout << "emplace_hint wrong -> " << it->first << "=" << it->second << std::endl;
+	it = m.emplace_hint(m.find(25), 25, 77);
+	std::cout << "emplace_hint present -> " << it->first << "=" << it->second << std::endl;
+	print(m);
+
+	// random keys under all three kinds of hint against std::map
+	Map r;
+	std::map<int, int> ref;
+	for (int i = 0; i < 30000; ++i) {
+		int k = rand() % 10000, v = rand();
+		Map::const_iterator hint;
+		switch (i % 3) {
+		case 0: hint = r.cend(); break;
+		case 1: {
+			std::map<int, int>::iterator up = ref.upper_bound(k);
+			hint = up == ref.end() ? r.cend() : Map::const_iterator(r.find(up->first));
+			break;
+		}
+		default: hint = r.cbegin();
+		}
+		if (i & 1) r.insert(hint, Map::value_type(k, v));
+		else r.emplace_hint(hint, k, v);
+		ref.insert(std::make_pair(k, v));
+		if (i % 5 == 0) {
+			Map::iterator f = r.find(rand() % 10000);
+			if (f != r.end()) {
+				ref.erase(f->first);
+				r.erase(f);
+			}
+		}
+	}
+	std::cout << (same(r, ref) ? "random hints OK" : "random hints FAIL") << std::endl;
+
+	// a hint from another map is refused
+	Map other;
+	try {
+		m.insert(other.cend(), Map::value_type(1, 1));
+		std::cout << "foreign hint accepted" << std::endl;
+	} catch (sjtu::invalid_iterator &) {
+		std::cout << "foreign hint refused" << std::endl;
+	}
+	return 0;
+}
@@ -0,0 +1,98 @@
+#include "map.hpp"
+#include <iostream>
+#include <map>
+#include <memory>
+#include <string>
+#include <cstdlib>
+
+template<class T, class Op>
+using AggMap = sjtu::map<int, T, std::less<int>, std::allocator<sjtu::pair<const int, T>>, sjtu::augmented_policy<Op>>;
+
+typedef AggMap<long long, sjtu::agg_sum<long long>> SumMap;
+typedef AggMap<int, sjtu::agg_min<int>> MinMap;
+typedef AggMap<int, sjtu::agg_max<int>> MaxMap;
+
+// concatenation does not commute, so it shows the fold keeps key order
+struct Concat {
+	typedef std::string value_type;
+	std::string identity() const {
+		return "";
+	}
+	std::string operator()(const std::string &a, const std::string &b) const {
+		return a + b;
+	}
+};
+typedef AggMap<std::string, Concat> StrMap;
+
+long long slowSum(const std::map<int, long long> &ref, int lo, int hi) {
+	long long ret = 0;
+	for (std::map<int, long long>::const_iterator it = ref.lower_bound(lo); it != ref.end() && it->first < hi; ++it)
+		ret += it->second;
+	return ret;
+}
+
+int main() {
+	SumMap s;
+	// inserted whole: a value assigned through operator[] would need a refresh
+	for (int i = 1; i <= 10; ++i) s.insert(SumMap::value_type(i, i * i));
+	std::cout << "sum " << s.aggregate() << " [3, 7) " << s.aggregate(3, 7) << " [0, 100) " << s.aggregate(0, 100)
+	          << " [5, 5) " << s.aggregate(5, 5) << " [8, 2) " << s.aggregate(8, 2) << " [11, 20) " << s.aggregate(11, 20) << std::endl;
+	// erases, including interior nodes, must leave the sums right
+	s.erase(s.find(5));
+	s.erase(s.find(1));
+	s.erase(s.find(8));
+	std::cout << "after erase: sum " << s.aggregate() << " [3, 7) " << s.aggregate(3, 7)
+	          << " [1, 9) " << s.aggregate(1, 9) << std::endl;
+	// in-place changes are reported with refresh, insert_or_assign folds itself
+	SumMap::iterator it = s.find(4);
+	it->second = 1000;
+	s.refresh(it);
+	s.insert_or_assign(6, 2000LL);
+	std::cout << "after update: sum " << s.aggregate() << " [3, 7) " << s.aggregate(3, 7) << std::endl;
+
+	MinMap mn;
+	MaxMap mx;
+	int vals[] = {7, -3, 12, 0, 5, -8, 9};
+	for (int i = 0; i < 7; ++i) {
+		mn.insert(MinMap::value_type(i, vals[i]));
+		mx.insert(MaxMap::value_type(i, vals[i]));
+	}
+	std::cout << "min " << mn.aggregate() << " [0, 3) " << mn.aggregate(0, 3) << " [3, 7) " << mn.aggregate(3, 7) << std::endl;
+	std::cout << "max " << mx.aggregate() << " [0, 2) " << mx.aggregate(0, 2) << " [3, 7) " << mx.aggregate(3, 7) << std::endl;
+	mn.erase(mn.find(5));
+	mx.erase(mx.find(2));
+	std::cout << "after erase: min " << mn.aggregate() << " max " << mx.aggregate() << std::endl;
+
+	StrMap str;
+	const char *words[] = {"d", "a", "f", "c", "b", "e", "g"};
+	for (int i = 0; i < 7; ++i) str.insert(StrMap::value_type(words[i][0] - 'a', words[i]));
+	std::cout << "concat " << str.aggregate() << " [1, 5) " << str.aggregate(1, 5) << std::endl;
+	str.erase(str.find(3));
+	std::cout << "after erase " << str.aggregate() << " [1, 5) " << str.aggregate(1, 5) << std::endl;
+
+	// random range sums against a walk over std::map
+	SumMap r;
+	std::map<int, long long> ref;
+	bool ok = true;
+	for (int i = 0; i < 20000 && ok; ++i) {
+		int k = rand() % 3000;
+		if (i % 3 == 0) {
+			SumMap::iterator f = r.find(k);
+			if (f != r.end()) r.erase(f);
+			ref.erase(k);
+		}
+		else {
+			long long v = rand() % 1000 - 500;
+			r[k] = v;
+			r.refresh(r.find(k));
+			ref[k] = v;
+		}
+		if (i % 10 == 0) {
+			int lo = rand() % 3200 - 100, hi = rand() % 3200 - 100;
+			if (r.aggregate(lo, hi) != slowSum(ref, lo, hi)) ok = false;
+			if (r.aggregate() != slowSum(ref, -1, 3001)) ok = false;
+		}
+	}
+	std::cout << (ok ? "random sums OK" : "random sums FAIL") << std::endl;
+	return 0;
+}
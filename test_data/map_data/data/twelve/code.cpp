@@ -0,0 +1,81 @@
+#include "map.hpp"
+#include <iostream>
+#include <map>
+#include <cstdlib>
+#include <iterator>
+
+typedef sjtu::map<int, int> Map;
+
+void show(const Map &m, Map::const_iterator it) {
+	if (it == m.cend()) std::cout << "end";
+	else std::cout << it->first;
+}
+
+int main() {
+	Map m;
+	for (int i = 1; i <= 10; ++i) m[i * 10] = i;
+	const Map &c = m;
+	// below everything, on a key, between keys, past everything
+	int probes[] = {-5, 10, 35, 50, 100, 101};
+	for (int k : probes) {
+		std::cout << k << ": lower ";
+		show(c, c.lower_bound(k));
+		std::cout << " upper ";
+		show(c, c.upper_bound(k));
+		sjtu::pair<Map::const_iterator, Map::const_iterator> r = c.equal_range(k);
+		std::cout << " equal [";
+		show(c, r.first);
+		std::cout << ", ";
+		show(c, r.second);
+		std::cout << ") rank " << c.rank_of(k) << std::endl;
+	}
+	// the non-const overloads hand out writable iterators
+	m.lower_bound(35)->second = 400;
+	m.upper_bound(40)->second = 500;
+	std::cout << m[40] << " " << m[50] << std::endl;
+	sjtu::pair<Map::iterator, Map::iterator> e = m.equal_range(70);
+	std::cout << e.first->first << " " << e.second->first << std::endl;
+
+	int ranges[][2] = {{10, 100}, {10, 101}, {15, 55}, {50, 50}, {60, 20}, {-100, 5}, {200, 300}, {-100, 300}};
+	for (int i = 0; i < 8; ++i)
+		std::cout << "count_range [" << ranges[i][0] << ", " << ranges[i][1] << ") = "
+		          << c.count_range(ranges[i][0], ranges[i][1]) << std::endl;
+
+	// rank_of agrees with getByRank for keys that are there
+	bool ok = true;
+	for (int i = 1; i <= 10; ++i)
+		if (m.getByRank(m.rank_of(i * 10))->first != i * 10) ok = false;
+	std::cout << (ok ? "rank_of/getByRank OK" : "rank_of/getByRank FAIL") << std::endl;
+
+	Map empty;
+	std::cout << "empty: " << (empty.lower_bound(1) == empty.end()) << (empty.upper_bound(1) == empty.end())
+	          << " " << empty.count_range(0, 10) << " " << empty.rank_of(3) << std::endl;
+
+	// random keys and erases against std::map
+	Map r;
+	std::map<int, int> ref;
+	ok = true;
+	for (int i = 0; i < 20000 && ok; ++i) {
+		int k = rand() % 5000;
+		if (i % 3 == 2) {
+			Map::iterator f = r.find(k);
+			if (f != r.end()) r.erase(f);
+			ref.erase(k);
+		}
+		else {
+			r[k] = i;
+			ref[k] = i;
+		}
+		int a = rand() % 5200 - 100, b = rand() % 5200 - 100;
+		Map::iterator lb = r.lower_bound(a), ub = r.upper_bound(a);
+		std::map<int, int>::iterator rlb = ref.lower_bound(a), rub = ref.upper_bound(a);
+		if ((lb == r.end()) != (rlb == ref.end()) || (lb != r.end() && lb->first != rlb->first)) ok = false;
+		if ((ub == r.end()) != (rub == ref.end()) || (ub != r.end() && ub->first != rub->first)) ok = false;
+		size_t less = std::distance(ref.begin(), rlb);
+		if (r.rank_of(a) != (int)less + 1) ok = false;
+		size_t cnt = a < b ? std::distance(rlb, ref.lower_bound(b)) : 0;
+		if (r.count_range(a, b) != cnt) ok = false;
+	}
+	std::cout << (ok ? "random bounds OK" : "random bounds FAIL") << std::endl;
+	return 0;
+}
@@ -0,0 +1,139 @@
+#include "memory_resource.hpp"
+
+#include <iostream>
+#include <memory>
+#include <string>
+
+struct alignas(64) Wide {
+	int v;
+	Wide(int v = 0): v(v) {}
+};
+
+// counts live objects, so skipping destructors on an arena would show
+struct Counted {
+	static int alive;
+	int v;
+	Counted(int v = 0): v(v) {
+		++alive;
+	}
+	Counted(const Counted &other): v(other.v) {
+		++alive;
+	}
+	~Counted() {
+		--alive;
+	}
+	bool operator<(const Counted &other) const {
+		return v < other.v;
+	}
+};
+int Counted::alive = 0;
+
+bool Inside(const void *p, const char *buf, size_t size)
+{
+	const char *c = static_cast<const char *>(p);
+	return c >= buf && c < buf + size;
+}
+
+void TestArena()
+{
+	std::cout << "Testing monotonic_arena..." << std::endl;
+	alignas(64) char buf[256];
+	sjtu::monotonic_arena arena(buf, sizeof(buf), 128);
+	void *a = arena.allocate(1, 1);
+	void *b = arena.allocate(8, 32);
+	void *c = arena.allocate(24, 16);
+	std::cout << Inside(a, buf, sizeof(buf)) << Inside(b, buf, sizeof(buf)) << Inside(c, buf, sizeof(buf)) << " ";
+	std::cout << reinterpret_cast<size_t>(b) % 32 << " " << reinterpret_cast<size_t>(c) % 16 << std::endl;
+	// past the buffer: chunks come from the heap and still honour alignment
+	void *d = arena.allocate(1000, 64);
+	void *e = arena.allocate(5000, 128);
+	std::cout << Inside(d, buf, sizeof(buf)) << Inside(e, buf, sizeof(buf)) << " ";
+	std::cout << reinterpret_cast<size_t>(d) % 64 << " " << reinterpret_cast<size_t>(e) % 128 << std::endl;
+	arena.release();
+	void *f = arena.allocate(16);
+	std::cout << Inside(f, buf, sizeof(buf)) << std::endl;
+}
+
+void TestContainers()
+{
+	std::cout << "Testing containers on an arena..." << std::endl;
+	alignas(64) char buf[1024];
+	sjtu::monotonic_arena arena(buf, sizeof(buf), 256);
+	sjtu::pmr::vector<Wide> v(&arena);
+	bool aligned = true;
+	for (int i = 0; i < 1000; ++i) {
+		v.push_back(Wide(i));
+		aligned = aligned && reinterpret_cast<size_t>(&v[i]) % 64 == 0;
+	}
+	long sum = 0;
+	for (size_t i = 0; i < v.size(); ++i) sum += v[i].v;
+	std::cout << v.size() << " " << sum << " " << aligned << " " << Inside(&v[0], buf, sizeof(buf)) << std::endl;
+
+	sjtu::pmr::map<int, std::string> m(&arena);
+	for (int i = 0; i < 500; ++i) m[i * 7 % 500] = std::to_string(i);
+	std::cout << m.size() << " " << m.at(7) << " " << m.begin()->first << " " << (m.get_allocator().resource() == &arena) << std::endl;
+	sjtu::pmr::map<int, std::string> copy(m);
+	std::cout << copy.size() << " " << (copy.get_allocator().resource() == NULL) << std::endl;
+
+	sjtu::pmr::small_vector<std::string, 2> sv(&arena);
+	for (int i = 0; i < 10; ++i) sv.push_back(std::string(40, 'a' + i));
+	sjtu::pmr::ring_deque<int> rd(&arena);
+	for (int i = 0; i < 3000; ++i) {
+		if (i % 2) rd.push_back(i);
+		else rd.push_front(i);
+	}
+	sjtu::pmr::btree_map<int, int> bm(&arena);
+	sjtu::pmr::flat_map<int, int> fm(&arena);
+	for (int i = 0; i < 300; ++i) {
+		bm[i] = i;
+		fm[i] = -i;
+	}
+	std::cout << sv[9] << " " << rd.size() << " " << rd[0] << " " << rd[2999] << " " << bm.size() << " " << fm.at(299) << std::endl;
+}
+
+void TestSkipDeallocate()
+{
+	std::cout << "Testing skips_deallocate..." << std::endl;
+	sjtu::monotonic_arena arena;
+	std::cout << sjtu::skips_deallocate(sjtu::arena_allocator<int>(&arena)) << " ";
+	std::cout << sjtu::skips_deallocate(sjtu::arena_allocator<int>()) << " ";
+	std::cout << sjtu::skips_deallocate(std::allocator<int>()) << std::endl;
+	{
+		// trivially destructible: clear() and the destructors leave the
+		// memory to the arena without visiting it
+		sjtu::pmr::deque<int> d(&arena);
+		sjtu::pmr::priority_queue<int> q(&arena);
+		for (int i = 0; i < 5000; ++i) {
+			d.push_back(i);
+			q.push(i);
+		}
+		d.clear();
+		std::cout << d.size() << " " << d.empty() << " ";
+		for (int i = 0; i < 10; ++i) d.push_front(i);
+		std::cout << d.size() << " " << d[0] << " " << d[9] << " " << q.top() << std::endl;
+		q.clear();
+		q.push(42);
+		std::cout << q.size() << " " << q.top() << std::endl;
+	}
+	{
+		// anything with a destructor is still destroyed
+		sjtu::pmr::deque<Counted> d(&arena);
+		sjtu::pmr::priority_queue<Counted> q(&arena);
+		for (int i = 0; i < 1000; ++i) {
+			d.push_back(Counted(i));
+			q.push(Counted(i));
+		}
+		std::cout << Counted::alive << " ";
+		d.clear();
+		std::cout << Counted::alive << " ";
+	}
+	std::cout << Counted::alive << std::endl;
+}
+
+int main()
+{
+	TestArena();
+	TestContainers();
+	TestSkipDeallocate();
+	return 0;
+}
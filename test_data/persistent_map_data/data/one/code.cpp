@@ -0,0 +1,90 @@
+#include "persistent_map.hpp"
+
+#include <iostream>
+#include <string>
+
+void TestSnapshot()
+{
+	std::cout << "Testing snapshots..." << std::endl;
+	sjtu::persistent_map<int, std::string> m;
+	for (int i = 0; i < 10; ++i) {
+		m[i] = std::to_string(i * i);
+	}
+	sjtu::persistent_map<int, std::string> s = m.snapshot();
+	m.erase(m.find(3));
+	m[4] = "four";
+	m.insert_or_assign(20, "twenty");
+	std::cout << m.size() << " " << s.size() << std::endl;
+	for (sjtu::persistent_map<int, std::string>::const_iterator it = s.cbegin(); it != s.cend(); ++it) {
+		std::cout << it->first << ":" << it->second << " ";
+	}
+	std::cout << std::endl;
+	for (sjtu::persistent_map<int, std::string>::const_iterator it = m.cbegin(); it != m.cend(); ++it) {
+		std::cout << it->first << ":" << it->second << " ";
+	}
+	std::cout << std::endl;
+	s = m;
+	m.clear();
+	std::cout << m.size() << " " << s.size() << " " << s.at(4) << std::endl;
+}
+
+void TestVersions()
+{
+	std::cout << "Testing many versions..." << std::endl;
+	sjtu::persistent_map<int, int> m;
+	sjtu::persistent_map<int, int> versions[10];
+	for (int i = 0; i < 1000; ++i) {
+		m[i * 37 % 1009] = i;
+		if (i % 100 == 99) versions[i / 100] = m.snapshot();
+	}
+	for (int i = 0; i < 1009; i += 3) {
+		sjtu::persistent_map<int, int>::iterator it = m.find(i);
+		if (it != m.end()) m.erase(it);
+	}
+	for (int i = 0; i < 10; ++i) {
+		std::cout << versions[i].size() << " ";
+	}
+	std::cout << std::endl;
+	std::cout << m.size() << " " << m.getByRank(1)->first << " " << m.getByRank(m.size())->first << std::endl;
+	std::cout << versions[9].count(3) << " " << m.count(3) << " " << versions[4].at(37) << std::endl;
+	sjtu::persistent_map<int, int>::const_iterator it = m.cend();
+	--it;
+	int sum = 0, cnt = 0;
+	for (; ; --it) {
+		sum += it->second;
+		++cnt;
+		if (it == m.cbegin()) break;
+	}
+	std::cout << cnt << " " << sum << std::endl;
+}
+
+void TestException()
+{
+	sjtu::persistent_map<int, int> m;
+	int cnt = 0;
+	try {
+		m.at(1);
+	} catch (...) {
+		++cnt;
+	}
+	try {
+		m.getByRank(1);
+	} catch (...) {
+		++cnt;
+	}
+	try {
+		m.begin()++;
+	} catch (...) {
+		++cnt;
+	}
+	if (cnt == 3) std::cout << "exceptions thrown correctly." << std::endl;
+	else std::cout << "exceptions not thrown correctly." << std::endl;
+}
+
+int main()
+{
+	TestSnapshot();
+	TestVersions();
+	TestException();
+	return 0;
+}
@@ -0,0 +1,108 @@
+#include "ring_deque.hpp"
+
+#include <iostream>
+#include <string>
+
+void TestEnds()
+{
+	std::cout << "Testing push and pop at both ends..." << std::endl;
+	sjtu::ring_deque<int> q;
+	for (int i = 0; i < 5000; ++i) {
+		if (i % 2) q.push_back(i);
+		else q.push_front(i);
+	}
+	std::cout << q.size() << " " << q.front() << " " << q.back() << std::endl;
+	long long sum = 0;
+	for (size_t i = 0; i < q.size(); ++i) {
+		sum += q[i];
+	}
+	std::cout << sum << " " << q[2500] << " " << q.at(17) << std::endl;
+	while (q.size() > 3) {
+		q.pop_front();
+		q.pop_back();
+	}
+	for (sjtu::ring_deque<int>::iterator it = q.begin(); it != q.end(); ++it) {
+		std::cout << *it << " ";
+	}
+	std::cout << std::endl;
+	q.clear();
+	std::cout << q.empty() << std::endl;
+}
+
+void TestCopyAndIterators()
+{
+	std::cout << "Testing copies and iterators..." << std::endl;
+	sjtu::ring_deque<std::string> a;
+	for (int i = 0; i < 10; ++i) {
+		a.push_back(std::string(i + 1, 'x'));
+	}
+	const sjtu::ring_deque<std::string> b(a);
+	a.pop_front();
+	sjtu::ring_deque<std::string>::const_iterator it = b.cbegin() + 4;
+	std::cout << *it << " " << b.cend() - it << " " << a.front() << std::endl;
+	a = b;
+	std::cout << a.size() << " " << a.back() << std::endl;
+	sjtu::ring_deque<std::string> c(std::move(a));
+	std::cout << c.size() << " " << a.size() << std::endl;
+}
+
+void TestInsertErase()
+{
+	std::cout << "Testing insert and erase functions..." << std::endl;
+	sjtu::ring_deque<std::string> q;
+	for (int i = 0; i < 6; ++i) {
+		q.push_back(std::string(1, 'a' + i));
+	}
+	q.insert(q.begin() + 1, "X");
+	q.insert(q.begin() + 5, "Y");
+	q.insert(q.end(), "Z");
+	for (size_t i = 0; i < q.size(); ++i) {
+		std::cout << q[i] << " ";
+	}
+	std::cout << std::endl;
+	q.erase(q.begin() + 1);
+	sjtu::ring_deque<std::string>::iterator it = q.erase(q.begin() + 4);
+	q.erase(q.end() - 1);
+	for (size_t i = 0; i < q.size(); ++i) {
+		std::cout << q[i] << " ";
+	}
+	std::cout << *it << std::endl;
+}
+
+void TestException()
+{
+	sjtu::ring_deque<int> q;
+	int cnt = 0;
+	try {
+		q.pop_back();
+	} catch (...) {
+		++cnt;
+	}
+	try {
+		q.front();
+	} catch (...) {
+		++cnt;
+	}
+	q.push_back(1);
+	try {
+		q[1];
+	} catch (...) {
+		++cnt;
+	}
+	try {
+		q.end()++;
+	} catch (...) {
+		++cnt;
+	}
+	if (cnt == 4) std::cout << "exceptions thrown correctly." << std::endl;
+	else std::cout << "exceptions not thrown correctly." << std::endl;
+}
+
+int main()
+{
+	TestEnds();
+	TestCopyAndIterators();
+	TestInsertErase();
+	TestException();
+	return 0;
+}
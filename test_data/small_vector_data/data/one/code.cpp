@@ -0,0 +1,80 @@
+#include "small_vector.hpp"
+
+#include <iostream>
+#include <string>
+
+void TestInlineAndSpill()
+{
+	std::cout << "Testing inline storage and spilling to the heap..." << std::endl;
+	sjtu::small_vector<int, 4> v;
+	std::cout << v.capacity() << " " << v.is_inline() << std::endl;
+	for (int i = 1; i <= 4; ++i) {
+		v.push_back(i);
+	}
+	std::cout << v.size() << " " << v.is_inline() << std::endl;
+	v.push_back(5);
+	std::cout << v.size() << " " << v.is_inline() << std::endl;
+	for (sjtu::small_vector<int, 4>::iterator it = v.begin(); it != v.end(); ++it) {
+		std::cout << *it << " ";
+	}
+	std::cout << std::endl;
+	v.clear();
+	std::cout << v.size() << " " << v.is_inline() << std::endl;
+}
+
+void TestCopy()
+{
+	std::cout << "Testing constructors and assignment operator..." << std::endl;
+	sjtu::small_vector<std::string, 3> small, big;
+	small.push_back("a");
+	small.push_back("b");
+	for (int i = 0; i < 10; ++i) {
+		big.push_back(std::string(i + 1, 'x'));
+	}
+	const sjtu::small_vector<std::string, 3> sc(small), bc(big);
+	for (sjtu::small_vector<std::string, 3>::const_iterator it = sc.cbegin(); it != sc.cend(); ++it) {
+		std::cout << *it << " ";
+	}
+	std::cout << sc.is_inline() << std::endl;
+	std::cout << bc.back() << " " << bc.is_inline() << std::endl;
+	big = small;
+	std::cout << big.size() << " " << big.back() << " " << big.is_inline() << std::endl;
+	small = bc;
+	std::cout << small.size() << " " << small.front() << std::endl;
+}
+
+void TestInsertErase()
+{
+	std::cout << "Testing insert and erase functions..." << std::endl;
+	sjtu::small_vector<std::string, 8> v;
+	for (int i = 0; i < 6; ++i) {
+		v.push_back(std::string(1, 'a' + i));
+	}
+	v.insert(v.begin() + 3, "X");
+	v.insert(0, "Y");
+	v.insert(v.size(), "Z");
+	for (size_t i = 0; i < v.size(); ++i) {
+		std::cout << v[i] << " ";
+	}
+	std::cout << v.is_inline() << std::endl;
+	v.erase(v.begin() + 4);
+	v.erase(0);
+	v.pop_back();
+	for (size_t i = 0; i < v.size(); ++i) {
+		std::cout << v[i] << " ";
+	}
+	std::cout << std::endl;
+	try {
+		v.at(100);
+	} catch(...) {
+		std::cout << "exceptions thrown correctly." << std::endl;
+	}
+}
+
+int main()
+{
+	TestInlineAndSpill();
+	TestCopy();
+	TestInsertErase();
+	return 0;
+}
@@ -0,0 +1,74 @@
+#include "small_vector.hpp"
+
+#include <iostream>
+#include <memory>
+#include <string>
+
+template<size_t N>
+void Print(const sjtu::small_vector<std::string, N> &v)
+{
+	for (typename sjtu::small_vector<std::string, N>::const_iterator it = v.cbegin(); it != v.cend(); ++it) {
+		std::cout << *it << " ";
+	}
+	std::cout << "(" << v.size() << ", " << v.is_inline() << ")" << std::endl;
+}
+
+sjtu::small_vector<std::string, 3> Make(const std::string &tag, int n)
+{
+	sjtu::small_vector<std::string, 3> v;
+	for (int i = 0; i < n; ++i) {
+		v.push_back(tag + std::to_string(i));
+	}
+	return v;
+}
+
+// every mix of inline and heap storage; heap buffers must change hands
+// without their elements moving
+void TestSwap()
+{
+	std::cout << "Testing swap..." << std::endl;
+	const int sizes[][2] = {{2, 1}, {1, 3}, {2, 6}, {7, 0}, {5, 9}};
+	for (int k = 0; k < 5; ++k) {
+		sjtu::small_vector<std::string, 3> a = Make("a", sizes[k][0]), b = Make("b", sizes[k][1]);
+		const std::string *aFirst = a.empty() ? NULL : &a[0];
+		const std::string *bFirst = b.empty() ? NULL : &b[0];
+		bool aHeap = !a.is_inline(), bHeap = !b.is_inline();
+		a.swap(b);
+		Print(a);
+		Print(b);
+		std::cout << (!bHeap || &a[0] == bFirst) << (!aHeap || &b[0] == aFirst) << std::endl;
+		a.swap(b);
+		Print(a);
+	}
+}
+
+void TestMoveOnly()
+{
+	std::cout << "Testing push_back of move-only values and reserve..." << std::endl;
+	sjtu::small_vector<std::unique_ptr<int>, 2> v;
+	for (int i = 0; i < 5; ++i) {
+		v.push_back(std::unique_ptr<int>(new int(i * i)));
+	}
+	v.reserve(20);
+	std::cout << v.size() << " " << v.capacity() << " " << v.is_inline() << std::endl;
+	v.reserve(3);
+	std::cout << v.capacity() << std::endl;
+	sjtu::small_vector<std::unique_ptr<int>, 2> w;
+	w.push_back(std::unique_ptr<int>(new int(-1)));
+	v.swap(w);
+	for (size_t i = 0; i < w.size(); ++i) {
+		std::cout << *w[i] << " ";
+	}
+	std::cout << "| " << *v[0] << " " << v.size() << std::endl;
+	sjtu::small_vector<std::string, 4> s;
+	s.reserve(10);
+	s.push_back("x");
+	std::cout << s.capacity() << " " << s.is_inline() << " " << s[0] << std::endl;
+}
+
+int main()
+{
+	TestSwap();
+	TestMoveOnly();
+	return 0;
+}
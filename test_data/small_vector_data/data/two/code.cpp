@@ -0,0 +1,44 @@
+#include "small_vector.hpp"
+
+#include <iostream>
+#include <string>
+
+// inserting or appending an element of the vector itself, both while the
+// elements are inline and once they are on the heap
+template<size_t N>
+void TestSelfInsert()
+{
+	std::cout << "Testing insert of the vector's own elements, N = " << N << "..." << std::endl;
+	sjtu::small_vector<std::string, N> v;
+	v.push_back(std::string(40, 'a'));
+	v.push_back(std::string(40, 'b'));
+	v.push_back(std::string(40, 'c'));
+	v.insert(0, v[1]);
+	v.insert(0, v[0]);
+	v.insert(v.begin() + 3, v[4]);
+	v.insert(v.size(), v[2]);
+	for (size_t i = 0; i < v.size(); ++i) {
+		std::cout << v[i].substr(0, 3) << " " << v[i].size() << std::endl;
+	}
+	std::cout << v.is_inline() << std::endl;
+}
+
+void TestSelfPushBack()
+{
+	std::cout << "Testing push_back of the vector's own elements..." << std::endl;
+	sjtu::small_vector<std::string, 2> v;
+	v.push_back(std::string(30, 'x'));
+	for (int i = 0; i < 20; ++i) {
+		v.push_back(v.back() + "y");
+		v.push_back(v[0]);
+	}
+	std::cout << v.size() << " " << v.back().size() << " " << v[v.size() - 2].size() << std::endl;
+}
+
+int main()
+{
+	TestSelfInsert<16>();
+	TestSelfInsert<2>();
+	TestSelfPushBack();
+	return 0;
+}
@@ -0,0 +1,77 @@
+#include "vector.hpp"
+
+#include <iostream>
+#include <memory>
+#include <string>
+
+// counts live instances, copies and moves; NoexceptMove picks whether
+// growth may move it or has to copy
+template<bool NoexceptMove>
+class Counted {
+public:
+	static int live, copies, moves;
+	std::string s;
+	explicit Counted(const std::string &x): s(x) {
+		++live;
+	}
+	Counted(const Counted &other): s(other.s) {
+		++live;
+		++copies;
+	}
+	Counted(Counted &&other) noexcept(NoexceptMove): s(std::move(other.s)) {
+		++live;
+		++moves;
+	}
+	~Counted() {
+		--live;
+	}
+};
+template<bool NoexceptMove> int Counted<NoexceptMove>::live = 0;
+template<bool NoexceptMove> int Counted<NoexceptMove>::copies = 0;
+template<bool NoexceptMove> int Counted<NoexceptMove>::moves = 0;
+
+void TestMoveOnly()
+{
+	std::cout << "Testing growth with a move-only type..." << std::endl;
+	sjtu::vector<std::unique_ptr<int>> v;
+	for (int i = 0; i < 1000; ++i) {
+		v.push_back(std::unique_ptr<int>(new int(i)));
+	}
+	long long sum = 0;
+	bool ok = true;
+	for (size_t i = 0; i < v.size(); ++i) {
+		ok = ok && v[i] && *v[i] == (int)i;
+		sum += *v[i];
+	}
+	std::cout << v.size() << " " << sum << " " << ok << std::endl;
+}
+
+template<bool NoexceptMove>
+void TestCounted()
+{
+	typedef Counted<NoexceptMove> C;
+	std::cout << "Testing growth with a counted type, noexcept move = " << NoexceptMove << "..." << std::endl;
+	{
+		sjtu::vector<C> v;
+		for (int i = 0; i < 500; ++i) {
+			v.push_back(C(std::to_string(i)));
+		}
+		bool ok = true;
+		for (size_t i = 0; i < v.size(); ++i) {
+			ok = ok && v[i].s == std::to_string(i);
+		}
+		std::cout << v.size() << " " << C::live << " " << ok << std::endl;
+		// each element was pushed by one move; growth then moves them
+		// again when it may, and copies them when it must
+		std::cout << (C::copies > 0) << " " << (C::moves > 500) << std::endl;
+	}
+	std::cout << C::live << std::endl;
+}
+
+int main()
+{
+	TestMoveOnly();
+	TestCounted<true>();
+	TestCounted<false>();
+	return 0;
+}
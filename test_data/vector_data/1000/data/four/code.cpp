@@ -0,0 +1,108 @@
+#include "vector.hpp"
+
+#include <iostream>
+#include <string>
+
+// inserting or appending an element of the vector itself: the copy must
+// be taken before the tail is shifted or the buffer grows
+void TestSelfInsert()
+{
+	std::cout << "Testing insert of the vector's own elements..." << std::endl;
+	sjtu::vector<std::string> v;
+	v.push_back(std::string(40, 'a'));
+	v.push_back(std::string(40, 'b'));
+	v.push_back(std::string(40, 'c'));
+	v.insert(0, v[1]);
+	v.insert(0, v[0]);
+	v.insert(v.begin() + 3, v[4]);
+	v.insert(v.size(), v[2]);
+	for (size_t i = 0; i < v.size(); ++i) {
+		std::cout << v[i].substr(0, 3) << " " << v[i].size() << std::endl;
+	}
+}
+
+void TestSelfPushBack()
+{
+	std::cout << "Testing push_back of the vector's own elements..." << std::endl;
+	sjtu::vector<std::string> v;
+	v.push_back(std::string(30, 'x'));
+	// each push_back that hits capacity copies an element of the old buffer
+	for (int i = 0; i < 40; ++i) {
+		v.push_back(v.back() + "y");
+		v.push_back(v[0]);
+	}
+	std::cout << v.size() << " " << v.back().size() << " " << v[v.size() - 2].size() << " " << v[79].substr(28, 4) << std::endl;
+	sjtu::vector<std::string> w;
+	w.push_back(std::string(30, 'm'));
+	for (int i = 0; i < 20; ++i) {
+		w.push_back(std::move(w[w.size() - 1]));
+	}
+	std::cout << w.size() << " " << w.back().size() << std::endl;
+}
+
+// a string whose copies can be made to throw; live counts the instances
+class Fragile {
+public:
+	static int live, copiesLeft;
+	std::string s;
+	Fragile(const std::string &x): s(x) {
+		++live;
+	}
+	Fragile(const Fragile &other): s(other.s) {
+		if (copiesLeft == 0) throw 0;
+		if (copiesLeft > 0) --copiesLeft;
+		++live;
+	}
+	~Fragile() {
+		--live;
+	}
+};
+int Fragile::live = 0;
+int Fragile::copiesLeft = -1;
+
+void TestThrowingShift()
+{
+	std::cout << "Testing copies that throw while shifting..." << std::endl;
+	{
+		sjtu::vector<Fragile> v;
+		for (int i = 0; i < 8; ++i) {
+			v.push_back(Fragile(std::to_string(i)));
+		}
+		std::cout << v.size() << " " << Fragile::live << std::endl;
+		// the value itself copies fine, then a shift copy throws
+		Fragile::copiesLeft = 3;
+		try {
+			v.insert(2, Fragile("new"));
+			std::cout << "no throw" << std::endl;
+		} catch (int) {
+			std::cout << "thrown" << std::endl;
+		}
+		Fragile::copiesLeft = -1;
+		// whatever is left is whole and counted
+		std::cout << v.size() << " " << Fragile::live << ":";
+		for (size_t i = 0; i < v.size(); ++i) {
+			std::cout << " " << v[i].s;
+		}
+		std::cout << std::endl;
+		Fragile::copiesLeft = 0;
+		try {
+			v.insert(0, v[1]);
+		} catch (int) {
+			std::cout << "thrown before anything moved" << std::endl;
+		}
+		Fragile::copiesLeft = -1;
+		std::cout << v.size() << " " << Fragile::live << std::endl;
+		v.push_back(Fragile("end"));
+		v.erase(0);
+		std::cout << v.size() << " " << Fragile::live << " " << v[0].s << " " << v.back().s << std::endl;
+	}
+	std::cout << "live after destruction " << Fragile::live << std::endl;
+}
+
+int main()
+{
+	TestSelfInsert();
+	TestSelfPushBack();
+	TestThrowingShift();
+	return 0;
+}
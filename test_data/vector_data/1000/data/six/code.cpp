@@ -0,0 +1,132 @@
+#include "vector.hpp"
+
+#include <iostream>
+#include <string>
+#include <vector>
+
+// counts live instances, copies and moves
+class Counted {
+public:
+	static int live, copies, moves;
+	std::string s;
+	explicit Counted(const std::string &x): s(x) {
+		++live;
+	}
+	Counted(const Counted &other): s(other.s) {
+		++live;
+		++copies;
+	}
+	Counted(Counted &&other) noexcept: s(std::move(other.s)) {
+		++live;
+		++moves;
+	}
+	Counted &operator=(const Counted &other) {
+		s = other.s;
+		return *this;
+	}
+	~Counted() {
+		--live;
+	}
+};
+int Counted::live = 0, Counted::copies = 0, Counted::moves = 0;
+
+// owns its digits through a plain pointer, like the Bint in class-bint.hpp,
+// and opts in to being moved as bytes
+class Digits {
+public:
+	static int live, copies;
+	int *d;
+	int n;
+	explicit Digits(int x): d(new int[1]), n(1) {
+		d[0] = x;
+		++live;
+	}
+	Digits(const Digits &other): d(new int[other.n]), n(other.n) {
+		for (int i = 0; i < n; ++i) d[i] = other.d[i];
+		++live;
+		++copies;
+	}
+	Digits &operator=(const Digits &) = delete;
+	~Digits() {
+		delete [] d;
+		--live;
+	}
+};
+int Digits::live = 0, Digits::copies = 0;
+
+namespace sjtu {
+template<> struct is_trivially_relocatable<Digits> : std::true_type {};
+}
+
+// the same inserts and erases on a std::vector of the values, as reference
+template<class V, class Make, class Get>
+bool Shuffle(V &v, const Make &make, const Get &get, int &inserts)
+{
+	std::vector<int> ref;
+	for (int i = 0; i < 200; ++i) {
+		v.push_back(make(i));
+		ref.push_back(i);
+	}
+	inserts = 0;
+	for (int i = 0; i < 300; ++i) {
+		size_t pos = (i * 37) % (ref.size() + 1);
+		if (i % 3 == 2) {
+			pos = (i * 37) % ref.size();
+			v.erase(pos);
+			ref.erase(ref.begin() + pos);
+		}
+		else {
+			v.insert(pos, make(1000 + i));
+			ref.insert(ref.begin() + pos, 1000 + i);
+			++inserts;
+		}
+	}
+	if (v.size() != ref.size()) return false;
+	for (size_t i = 0; i < ref.size(); ++i) {
+		if (get(v[i]) != ref[i]) return false;
+	}
+	return true;
+}
+
+void TestCountedShift()
+{
+	std::cout << "Testing insert and erase shifting a counted type..." << std::endl;
+	{
+		sjtu::vector<Counted> v;
+		v.reserve(1000);
+		int inserts;
+		bool ok = Shuffle(v, [](int x) {
+			return Counted(std::to_string(x));
+		}, [](const Counted &c) {
+			return std::stoi(c.s);
+		}, inserts);
+		// insert copies its argument once; shifting only moves
+		std::cout << ok << " " << v.size() << " " << Counted::live << " " << (Counted::copies == inserts) << std::endl;
+	}
+	std::cout << Counted::live << std::endl;
+}
+
+void TestRelocatableShift()
+{
+	std::cout << "Testing insert and erase shifting an opted-in relocatable type..." << std::endl;
+	{
+		sjtu::vector<Digits> v;
+		int inserts;
+		bool ok = Shuffle(v, [](int x) {
+			return Digits(x);
+		}, [](const Digits &c) {
+			return c.d[0];
+		}, inserts);
+		// shifting and growth move bytes, so only the values handed to
+		// push_back and insert are ever copied
+		std::cout << ok << " " << v.size() << " " << Digits::live << " " << (Digits::copies == inserts + 200) << std::endl;
+	}
+	std::cout << Digits::live << std::endl;
+}
+
+int main()
+{
+	TestCountedShift();
+	TestRelocatableShift();
+	return 0;
+}